@@ -32,6 +32,13 @@ export namespace aa
 	{
 		return vmath::vec<2>(film_x * samples_x, film_y * samples_y);
 	}
+	// Sampling-grid cell (subpixel) containing the sample jittered from [rand_u]/[rand_v]
+	u32 subpixel_ndx(float rand_u, float rand_v)
+	{
+		const u32 x = vmath::min(static_cast<u32>(rand_u * samples_x), samples_x - 1);
+		const u32 y = vmath::min(static_cast<u32>(rand_v * samples_y), samples_y - 1);
+		return x + y * samples_x;
+	}
 	vmath::vec<2> jitter(float rand_u, float rand_v)
 	{
 		// Jitter inside the sampling grid
@@ -0,0 +1,737 @@
+export module bench;
+
+import vmath;
+import geometry;
+import camera;
+import parallel;
+import platform;
+import mem;
+import path;
+import ui;
+import vox_ints;
+
+// Offline traversal benchmarks; these run once after geometry upload and before any tracing work is launched
+// (see [TRAVERSAL_BENCH] in vox_sculpt.cpp), and write their results to the debug log
+// Brick shapes are compile-time switches (see [BRICK_SHAPE_...] in geometry.ixx), so the full benchmark matrix is
+// collected by rebuilding once per shape and comparing the logged numbers
+
+//#define BENCH_DBG
+#ifdef BENCH_DBG
+#pragma optimize("", off)
+#endif
+
+export namespace bench
+{
+    // Recorded rays, in the same worldspace format we pass into [scene::isect]
+    struct bench_ray
+    {
+        vmath::vec<3> ori;
+        vmath::vec<3> dir;
+    };
+
+    // Ray sets we replay against each traversal kernel
+    enum RAY_SETS
+    {
+        COHERENT_PRIMARY, // Camera rays over a block of neighbouring pixels, moved onto the grid boundary
+        INCOHERENT_BOUNCE, // Random origins inside the grid with uniformly-distributed directions, standing in for diffuse bounces
+        GRAZING_BOUNCE, // Random origins inside the grid, with directions nearly parallel to one of the grid axes (worst case for per-step cost & ties)
+        NUM_RAY_SETS
+    };
+    constexpr const char* ray_set_names[NUM_RAY_SETS] = { "coherent primary", "incoherent bounce", "grazing bounce" };
+    constexpr u32 max_rays_per_set = 512 * 512;
+    bench_ray* ray_sets[NUM_RAY_SETS] = {};
+    u32 ray_set_sizes[NUM_RAY_SETS] = {};
+
+    // Record camera rays over a square block of pixels centred on the volume's screen-space bounds
+    // Rays missing the grid are dropped, so the recorded count can be lower than [max_rays_per_set]
+    void record_primary_rays(bench_ray* rays, u32* num_rays)
+    {
+        const geometry::vol::transform_nfo& transf = geometry::vol::metadata->transf;
+        const vmath::vec<2> quad_centre = (transf.ss_v0 + transf.ss_v3) * 0.5f;
+        constexpr i32 block_width = 512;
+        const i32 min_x = vmath::clamp(static_cast<i32>(quad_centre.x()) - (block_width / 2), 0, static_cast<i32>(ui::window_width - block_width));
+        const i32 min_y = vmath::clamp(static_cast<i32>(quad_centre.y()) - (block_width / 2), 0, static_cast<i32>(ui::window_height - block_width));
+        u32 ctr = 0;
+        for (i32 y = min_y; y < (min_y + block_width); y++)
+        {
+            for (i32 x = min_x; x < (min_x + block_width); x++)
+            {
+                const tracing::path_vt cam_vt = camera::lens_sample(x, y, 0.5f, 0.5f, 0.5f);
+                bench_ray r;
+                r.ori = cam_vt.ori;
+                r.dir = cam_vt.dir;
+                geometry::vol::vol_nfo nfo;
+                if (geometry::test(r.dir, &r.ori, &nfo))
+                {
+                    rays[ctr] = r;
+                    ctr++;
+                }
+            }
+        }
+        *num_rays = ctr;
+
+        // Lens sampling accumulates filter weights; clear those so they don't leak into the first rendered frame
+        platform::osClearMem(camera::filter_sum_grid, camera::filter_sum_grid_footprint);
+    }
+
+    // Record rays with random origins inside the grid and uniformly random directions
+    void record_bounce_rays(bench_ray* rays, u32* num_rays)
+    {
+        const geometry::vol::transform_nfo& transf = geometry::vol::metadata->transf;
+        const vmath::vec<3> bounds_min = transf.pos - (transf.scale * 0.5f);
+        float sample[4];
+        for (u32 i = 0; i < max_rays_per_set; i++)
+        {
+            parallel::rand_streams[0].next(sample);
+            rays[i].ori = bounds_min + (transf.scale * vmath::vec<3>(sample[0], sample[1], sample[2]));
+
+            // Uniform sphere directions (z in [-1...1], uniform azimuth)
+            parallel::rand_streams[0].next(sample);
+            const float z = (sample[0] * 2.0f) - 1.0f;
+            const float r = vmath::fsqrt(vmath::max(1.0f - (z * z), 0.0f));
+            const float phi = sample[1] * vmath::pi_2;
+            rays[i].dir = vmath::vec<3>(r * vmath::fcos(phi), r * vmath::fsin(phi), z);
+        }
+        *num_rays = max_rays_per_set;
+    }
+
+    // Record rays with random origins inside the grid, travelling almost parallel to a (rotating) grid plane
+    void record_grazing_rays(bench_ray* rays, u32* num_rays)
+    {
+        const geometry::vol::transform_nfo& transf = geometry::vol::metadata->transf;
+        const vmath::vec<3> bounds_min = transf.pos - (transf.scale * 0.5f);
+        float sample[4];
+        for (u32 i = 0; i < max_rays_per_set; i++)
+        {
+            parallel::rand_streams[0].next(sample);
+            rays[i].ori = bounds_min + (transf.scale * vmath::vec<3>(sample[0], sample[1], sample[2]));
+
+            // Uniform directions within the plane, plus a small (signed) component along the plane normal
+            parallel::rand_streams[0].next(sample);
+            const u8 normal_axis = i % 3;
+            const float phi = sample[0] * vmath::pi_2;
+            const float tilt = ((sample[1] * 2.0f) - 1.0f) * 0.01f;
+            rays[i].dir.e[normal_axis] = tilt;
+            rays[i].dir.e[(normal_axis + 1) % 3] = vmath::fcos(phi);
+            rays[i].dir.e[(normal_axis + 2) % 3] = vmath::fsin(phi);
+            rays[i].dir = rays[i].dir.normalized();
+        }
+        *num_rays = max_rays_per_set;
+    }
+
+    // Map a recorded worldspace ray into the voxel coordinates expected by [geometry::cell_step], then traverse it
+    // Mirrors the setup in [scene::isect]
+    bool cell_step_replay(bench_ray r, bool primary_ray, vmath::vec<3, i32>* voxel_out)
+    {
+        const geometry::vol::transform_nfo& transf = geometry::vol::metadata->transf;
+        vmath::vec<3> rel_p = (r.ori - transf.pos) + (transf.scale * 0.5f);
+        vmath::vec<3> uvw = rel_p / transf.scale;
+        vmath::vec<3> uvw_scaled = uvw * geometry::vol::width;
+        vmath::vec<3, i32> uvw_i = vmath::vec3_cast<vmath::vec<3>, vmath::vec<3, i32>>(vmath::vfloor(vmath::vabs(uvw_scaled)));
+        vmath::vec<3> n = vmath::vec<3>(0, 0, -1);
+        const bool hit = geometry::cell_step(r.dir, &r.ori, uvw_scaled, &uvw_i, &n, primary_ray);
+        *voxel_out = uvw_i;
+        return hit;
+    }
+
+    // Reference traversal; plain voxel-by-voxel DDA through the whole grid, with occupancy looked up from scratch every step
+    // Far too slow for rendering, but simple enough to trust as ground truth for hit-equivalence tests
+    bool reference_isect(const geometry::dda_ray& r, geometry::traversal_hit* hit_out, bool skip_origin)
+    {
+        i32 cell[3];
+        float t_max[3];
+        float t_delta[3];
+        for (u8 i = 0; i < 3; i++)
+        {
+            cell[i] = static_cast<i32>(r.o[i]);
+            t_max[i] = ((cell[i] + (r.step[i] > 0 ? 1 : 0)) - r.o[i]) * r.inv_d[i];
+            t_delta[i] = vmath::fabs(r.inv_d[i]);
+        }
+
+        float t = 0.0f;
+        u8 axis = r.entry_axis;
+        hit_out->hit = false;
+        for (;;)
+        {
+            const vmath::vec<3, i32> v(cell[0], cell[1], cell[2]);
+            const geometry::vol::voxel_ndces ndces = geometry::vol::voxel_index_solver(v);
+            const u64 chunk = geometry::vol::metachunks[geometry::vol::metachunk_index_solver(v)].chunks[ndces.chunk];
+            if ((chunk & ndces.bitmask) != 0 && !(skip_origin && t <= 0.0f))
+            {
+                hit_out->voxel = v;
+                hit_out->t = t;
+                hit_out->axis = axis;
+                hit_out->hit = true;
+                return true;
+            }
+            axis = (t_max[0] < t_max[1]) ? ((t_max[0] < t_max[2]) ? 0 : 2) :
+                                           ((t_max[1] < t_max[2]) ? 1 : 2);
+            t = t_max[axis];
+            t_max[axis] += t_delta[axis];
+            cell[axis] += r.step[axis];
+            if (cell[axis] < 0 || cell[axis] >= static_cast<i32>(geometry::vol::width)) return false;
+        }
+    }
+
+    // Hit-equivalence between traversal kernels; compares hit/miss status and intersected voxels for [cell_step] and [dda_isect]
+    // against [reference_isect]
+    // [cell_step] steps coarse levels diagonally and tests a fixed bit on voxel hits, so it isn't expected to match exactly; the
+    // numbers here show how far it drifts
+    void compare_kernels(RAY_SETS set)
+    {
+        const bool primary = (set == COHERENT_PRIMARY);
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        u32 cell_step_status_matches = 0, cell_step_voxel_matches = 0;
+        u32 dda_status_matches = 0, dda_voxel_matches = 0;
+        u32 num_reference_hits = 0;
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            const geometry::dda_ray r = geometry::make_dda_ray(rays[i].ori, rays[i].dir);
+            geometry::traversal_hit ref_hit, dda_hit;
+            const bool ref = reference_isect(r, &ref_hit, !primary);
+            const bool dda = geometry::dda_isect(r, &dda_hit, !primary);
+            vmath::vec<3, i32> cell_step_voxel;
+            const bool cell_step = cell_step_replay(rays[i], primary, &cell_step_voxel);
+
+            num_reference_hits += ref ? 1 : 0;
+            cell_step_status_matches += (cell_step == ref) ? 1 : 0;
+            dda_status_matches += (dda == ref) ? 1 : 0;
+            if (ref)
+            {
+                cell_step_voxel_matches += (cell_step && vmath::allEqualElements(cell_step_voxel, ref_hit.voxel)) ? 1 : 0;
+                dda_voxel_matches += (dda && vmath::allEqualElements(dda_hit.voxel, ref_hit.voxel)) ? 1 : 0;
+            }
+        }
+        platform::osDebugLogFmt("[%s] %s rays, %u reference hits: cell_step matches %u/%u hit states & %u/%u voxels, dda_isect matches %u/%u hit states & %u/%u voxels \n",
+                                geometry::vol::brick_shape_name, ray_set_names[set], num_reference_hits,
+                                cell_step_status_matches, num_rays, cell_step_voxel_matches, num_reference_hits,
+                                dda_status_matches, num_rays, dda_voxel_matches, num_reference_hits);
+    }
+
+    // Time one ray set against [geometry::cell_step], then log nanoseconds/ray and the fraction of rays hitting a voxel
+    void time_cell_step(RAY_SETS set)
+    {
+        const bool primary = (set == COHERENT_PRIMARY);
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        u32 num_hits = 0;
+        vmath::vec<3, i32> voxel;
+        const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            num_hits += cell_step_replay(rays[i], primary, &voxel) ? 1 : 0;
+        }
+        const u64 t1 = platform::osGetCurrentTimeNanoSeconds();
+        const double ns_per_ray = static_cast<double>(t1 - t0) / vmath::max(num_rays, 1u);
+        platform::osDebugLogFmt("[%s] cell_step, %s rays: %f ns/ray, %u/%u rays hit \n", geometry::vol::brick_shape_name, ray_set_names[set],
+                                ns_per_ray, num_hits, num_rays);
+    }
+
+    // Time one ray set against [geometry::dda_isect] (including per-ray table setup), logging the same numbers as [time_cell_step]
+    void time_dda(RAY_SETS set)
+    {
+        const bool primary = (set == COHERENT_PRIMARY);
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        u32 num_hits = 0;
+        geometry::traversal_hit hit;
+        const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            num_hits += geometry::dda_isect(geometry::make_dda_ray(rays[i].ori, rays[i].dir), &hit, !primary) ? 1 : 0;
+        }
+        const u64 t1 = platform::osGetCurrentTimeNanoSeconds();
+        const double ns_per_ray = static_cast<double>(t1 - t0) / vmath::max(num_rays, 1u);
+        platform::osDebugLogFmt("[%s] dda_isect, %s rays: %f ns/ray, %u/%u rays hit \n", geometry::vol::brick_shape_name, ray_set_names[set],
+                                ns_per_ray, num_hits, num_rays);
+    }
+
+    // Time any-hit occlusion queries against closest-hit traversal over the same rays, then check that both agree; unbounded
+    // queries should match closest-hit results exactly, and queries clipped just short of each closest hit should never be occluded
+    // Bounded queries stop halfway to each closest hit, roughly like connection rays between two path vertices
+    void time_occlusion(RAY_SETS set)
+    {
+        const bool primary = (set == COHERENT_PRIMARY);
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        float* bounds = mem::allocate_tracing<float>(sizeof(float) * num_rays);
+        geometry::traversal_hit hit;
+        u32 num_hits = 0, num_occluded = 0, num_bounded_occluded = 0;
+        const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            const bool closest = geometry::dda_isect(geometry::make_dda_ray(rays[i].ori, rays[i].dir), &hit, !primary);
+            num_hits += closest ? 1 : 0;
+            bounds[i] = closest ? hit.t * 0.5f : geometry::dda_unbounded;
+        }
+        const u64 t1 = platform::osGetCurrentTimeNanoSeconds();
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            num_occluded += geometry::dda_occluded(geometry::make_dda_ray(rays[i].ori, rays[i].dir), geometry::dda_segment(), !primary) ? 1 : 0;
+        }
+        const u64 t2 = platform::osGetCurrentTimeNanoSeconds();
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            num_bounded_occluded += geometry::dda_occluded(geometry::make_dda_ray(rays[i].ori, rays[i].dir), { 0.0f, bounds[i] }, !primary) ? 1 : 0;
+        }
+        const u64 t3 = platform::osGetCurrentTimeNanoSeconds();
+        mem::deallocate_tracing(sizeof(float) * num_rays);
+
+        // Validation
+        u32 state_matches = 0, clip_matches = 0;
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            const geometry::dda_ray r = geometry::make_dda_ray(rays[i].ori, rays[i].dir);
+            const bool closest = geometry::dda_isect(r, &hit, !primary);
+            state_matches += (geometry::dda_occluded(r, geometry::dda_segment(), !primary) == closest) ? 1 : 0;
+            clip_matches += (!closest || !geometry::dda_occluded(r, { 0.0f, hit.t * 0.999f }, !primary)) ? 1 : 0;
+        }
+        const double denom = vmath::max(num_rays, 1u);
+        platform::osDebugLogFmt("[%s] %s rays, occlusion: closest-hit %f ns/ray (%u hits), any-hit %f ns/ray (%u occluded), bounded any-hit %f ns/ray (%u occluded); %u/%u states match, %u/%u clipped queries unoccluded \n",
+                                geometry::vol::brick_shape_name, ray_set_names[set], (t1 - t0) / denom, num_hits, (t2 - t1) / denom, num_occluded,
+                                (t3 - t2) / denom, num_bounded_occluded, state_matches, num_rays, clip_matches, num_rays);
+    }
+
+    // Time short-range segment queries (a few voxels long, like local probes or short connection rays) against full traversal over
+    // the same rays; segment results should match full results clipped to the segment
+    void time_segments(RAY_SETS set)
+    {
+        const bool primary = (set == COHERENT_PRIMARY);
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        const double denom = vmath::max(num_rays, 1u);
+        geometry::traversal_hit hit;
+        u32 num_hits = 0;
+        const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            num_hits += geometry::dda_isect(geometry::make_dda_ray(rays[i].ori, rays[i].dir), &hit, !primary) ? 1 : 0;
+        }
+        const u64 t1 = platform::osGetCurrentTimeNanoSeconds();
+        const double full_ns = (t1 - t0) / denom;
+
+        constexpr u32 segment_voxels[3] = { 4, 16, 64 };
+        const float voxel_length = geometry::vol::view.voxel_to_world_scale.x(); // Worldspace width of one voxel (along x; voxels are cubic in the default volume)
+        for (u32 len = 0; len < 3; len++)
+        {
+            const geometry::dda_segment seg = { 0.0f, voxel_length * segment_voxels[len] };
+            u32 num_seg_hits = 0;
+            const u64 t2 = platform::osGetCurrentTimeNanoSeconds();
+            for (u32 i = 0; i < num_rays; i++)
+            {
+                num_seg_hits += geometry::dda_isect_segment(geometry::make_dda_ray(rays[i].ori, rays[i].dir), seg, &hit, !primary) ? 1 : 0;
+            }
+            const u64 t3 = platform::osGetCurrentTimeNanoSeconds();
+
+            // Validation
+            u32 matches = 0;
+            geometry::traversal_hit seg_hit;
+            for (u32 i = 0; i < num_rays; i++)
+            {
+                const geometry::dda_ray r = geometry::make_dda_ray(rays[i].ori, rays[i].dir);
+                const bool full = geometry::dda_isect(r, &hit, !primary) && hit.t <= seg.t_max;
+                const bool clipped = geometry::dda_isect_segment(r, seg, &seg_hit, !primary);
+                matches += (full == clipped && (!full || vmath::allEqualElements(hit.voxel, seg_hit.voxel))) ? 1 : 0;
+            }
+            const double seg_ns = (t3 - t2) / denom;
+            platform::osDebugLogFmt("[%s] %s rays, %u-voxel segments: full traversal %f ns/ray (%u hits), segments %f ns/ray (%u hits, %fx faster); %u/%u match clipped full traversal \n",
+                                    geometry::vol::brick_shape_name, ray_set_names[set], segment_voxels[len], full_ns, num_hits, seg_ns, num_seg_hits,
+                                    full_ns / vmath::max(seg_ns, 0.001), matches, num_rays);
+        }
+    }
+
+    // Sweep the interleave factor for [geometry::interleaved_isect] against back-to-back [geometry::dda_isect] calls
+    // Rays are set up in small batches (same cost for every variant), and hits are validated against single-ray traversal
+    template<u32 interleave>
+    u64 run_interleaved(const bench_ray* rays, u32 num_rays, bool skip_origin, u32* num_hits_out, u32* num_matches_out)
+    {
+        constexpr u32 batch_size = 512;
+        geometry::dda_ray batch[batch_size];
+        geometry::traversal_hit hits[batch_size];
+        geometry::traversal_hit ref;
+        u64 ns = 0;
+        for (u32 base = 0; base < num_rays; base += batch_size)
+        {
+            const u32 n = vmath::min(batch_size, num_rays - base);
+            for (u32 i = 0; i < n; i++)
+            {
+                batch[i] = geometry::make_dda_ray(rays[base + i].ori, rays[base + i].dir);
+            }
+            const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+            if constexpr (interleave == 0)
+            {
+                for (u32 i = 0; i < n; i++)
+                {
+                    geometry::dda_isect(batch[i], hits + i, skip_origin);
+                }
+            }
+            else
+            {
+                geometry::interleaved_isect<interleave>(batch, n, hits, skip_origin);
+            }
+            ns += platform::osGetCurrentTimeNanoSeconds() - t0;
+            for (u32 i = 0; i < n; i++)
+            {
+                *num_hits_out += hits[i].hit ? 1 : 0;
+                const bool ref_hit = geometry::dda_isect(batch[i], &ref, skip_origin);
+                *num_matches_out += (ref_hit == hits[i].hit && (!ref_hit || vmath::allEqualElements(ref.voxel, hits[i].voxel))) ? 1 : 0;
+            }
+        }
+        return ns;
+    }
+
+    void time_interleaving(RAY_SETS set)
+    {
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        const bool skip_origin = (set != COHERENT_PRIMARY);
+        const double denom = vmath::max(num_rays, 1u);
+        constexpr u32 factors[] = { 0, 1, 2, 4, 8, 16 }; // Zero is plain [dda_isect]
+        u64 (*runs[])(const bench_ray*, u32, bool, u32*, u32*) = { run_interleaved<0>, run_interleaved<1>, run_interleaved<2>,
+                                                                   run_interleaved<4>, run_interleaved<8>, run_interleaved<16> };
+        double single_ns = 0.0;
+        for (u32 f = 0; f < 6; f++)
+        {
+            u32 num_hits = 0, num_matches = 0;
+            const double ns = runs[f](rays, num_rays, skip_origin, &num_hits, &num_matches) / denom;
+            if (f == 0)
+            {
+                single_ns = ns;
+                platform::osDebugLogFmt("[%s] %s rays: single-ray exact %f ns/ray (%u hits) \n", geometry::vol::brick_shape_name, ray_set_names[set], ns, num_hits);
+            }
+            else
+            {
+                platform::osDebugLogFmt("[%s] %s rays: %u-way interleaved %f ns/ray (%u hits, %fx single-ray), %u/%u match single-ray traversal \n",
+                                        geometry::vol::brick_shape_name, ray_set_names[set], factors[f], ns, num_hits, single_ns / vmath::max(ns, 0.001),
+                                        num_matches, num_rays);
+            }
+        }
+    }
+
+    // Time traversal with chunk crossing masks (see [geometry::chunk_crossing_masks]), and log their footprint; voxel steps with &
+    // without masks are only counted in [TRAVERSAL_STATS] builds
+    void time_crossing_masks(RAY_SETS set)
+    {
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        const bool skip_origin = (set != COHERENT_PRIMARY);
+        const double denom = vmath::max(num_rays, 1u);
+        geometry::traversal_hit hit;
+        u64 voxel_steps[2] = {};
+        u64 skipped = 0, entered = 0;
+        u32 num_hits[2] = {};
+        double ns[2] = {};
+        for (u32 pass = 0; pass < (geometry::traversal_stats_enabled ? 2u : 1u); pass++)
+        {
+            geometry::dda_stats = geometry::traversal_stats();
+            geometry::dda_stats.use_crossing_masks = (pass == 0);
+            const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+            for (u32 i = 0; i < num_rays; i++)
+            {
+                num_hits[pass] += geometry::dda_isect(geometry::make_dda_ray(rays[i].ori, rays[i].dir), &hit, skip_origin) ? 1 : 0;
+            }
+            ns[pass] = (platform::osGetCurrentTimeNanoSeconds() - t0) / denom;
+            voxel_steps[pass] = geometry::dda_stats.voxel_steps;
+            if (pass == 0)
+            {
+                skipped = geometry::dda_stats.chunks_skipped;
+                entered = geometry::dda_stats.chunks_entered;
+            }
+        }
+        geometry::dda_stats = geometry::traversal_stats();
+        if constexpr (geometry::traversal_stats_enabled)
+        {
+            platform::osDebugLogFmt("[%s] %s rays: crossing masks (%u bytes) skip %f%% of occupied chunks; voxel steps/ray %f with masks, %f without (%u vs %u hits), %f ns/ray vs %f ns/ray \n",
+                                    geometry::vol::brick_shape_name, ray_set_names[set], geometry::chunk_crossing_table_footprint,
+                                    (100.0 * skipped) / vmath::max(entered, static_cast<u64>(1)), voxel_steps[0] / denom, voxel_steps[1] / denom, num_hits[0], num_hits[1], ns[0], ns[1]);
+        }
+        else
+        {
+            platform::osDebugLogFmt("[%s] %s rays: crossing masks (%u bytes), %f ns/ray (%u hits); enable [TRAVERSAL_STATS] in geometry.ixx to count voxel steps saved \n",
+                                    geometry::vol::brick_shape_name, ray_set_names[set], geometry::chunk_crossing_table_footprint, ns[0], num_hits[0]);
+        }
+    }
+
+    // Time octant-specialized traversal (see [geometry::metachunk_dda_finish_kernels]) against the generic kernel, per ray octant
+    // Rays are set up in batches and both kernels walk the same batch (alternating which goes first), so setup & cache warmth cancel out;
+    // hits are validated voxel-for-voxel
+    void time_octant_kernels(RAY_SETS set)
+    {
+        constexpr u32 batch_size = 512;
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        const bool skip_origin = (set != COHERENT_PRIMARY);
+        geometry::dda_ray batch[batch_size];
+        geometry::traversal_hit generic_hits[batch_size];
+        geometry::traversal_hit octant_hits[batch_size];
+        u64 generic_ns[8] = {}, octant_ns[8] = {};
+        u32 counts[8] = {}, matches[8] = {};
+        for (u32 base = 0, batch_ndx = 0; base < num_rays; base += batch_size, batch_ndx++)
+        {
+            const u32 n = vmath::min(batch_size, num_rays - base);
+            for (u32 i = 0; i < n; i++)
+            {
+                batch[i] = geometry::make_dda_ray(rays[base + i].ori, rays[base + i].dir);
+                counts[batch[i].octant]++;
+            }
+            for (u32 o = 0; o < 8; o++)
+            {
+                for (u32 pass = 0; pass < 2; pass++)
+                {
+                    const bool generic = ((pass + batch_ndx) & 1) == 0;
+                    const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+                    for (u32 i = 0; i < n; i++)
+                    {
+                        if (batch[i].octant != o) continue;
+                        if (generic) geometry::dda_isect_any_octant(batch[i], generic_hits + i, skip_origin);
+                        else geometry::dda_isect_octant(batch[i], octant_hits + i, skip_origin);
+                    }
+                    (generic ? generic_ns : octant_ns)[o] += platform::osGetCurrentTimeNanoSeconds() - t0;
+                }
+            }
+            for (u32 i = 0; i < n; i++)
+            {
+                const geometry::traversal_hit& a = generic_hits[i];
+                const geometry::traversal_hit& b = octant_hits[i];
+                matches[batch[i].octant] += (a.hit == b.hit && (!a.hit || (vmath::allEqualElements(a.voxel, b.voxel) && a.axis == b.axis))) ? 1 : 0;
+            }
+        }
+
+        u64 total_generic = 0, total_octant = 0;
+        for (u32 o = 0; o < 8; o++)
+        {
+            total_generic += generic_ns[o];
+            total_octant += octant_ns[o];
+            if (counts[o] == 0) continue;
+            platform::osDebugLogFmt("[%s] %s rays: octant %c%c%c (%u rays) generic %f ns/ray, specialized %f ns/ray (%fx), %u/%u match \n",
+                                    geometry::vol::brick_shape_name, ray_set_names[set], (o & 1) ? '-' : '+', (o & 2) ? '-' : '+', (o & 4) ? '-' : '+',
+                                    counts[o], static_cast<double>(generic_ns[o]) / counts[o], static_cast<double>(octant_ns[o]) / counts[o],
+                                    static_cast<double>(generic_ns[o]) / vmath::max(static_cast<double>(octant_ns[o]), 1.0), matches[o], counts[o]);
+        }
+        platform::osDebugLogFmt("[%s] %s rays: octant kernels overall %fx generic traversal \n", geometry::vol::brick_shape_name, ray_set_names[set],
+                                static_cast<double>(total_generic) / vmath::max(static_cast<double>(total_octant), 1.0));
+    }
+
+    // Time fixed-point traversal (see [geometry::fixed_dda_isect]) against float traversal, on the same ray batches; fixed-point timings
+    // include converting each ray with [geometry::make_fixed_dda_ray]
+    void time_fixed_point(RAY_SETS set)
+    {
+        constexpr u32 batch_size = 512;
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        const bool skip_origin = (set != COHERENT_PRIMARY);
+        const double denom = vmath::max(num_rays, 1u);
+        geometry::dda_ray batch[batch_size];
+        geometry::traversal_hit float_hits[batch_size];
+        geometry::traversal_hit fixed_hits[batch_size];
+        u64 float_ns = 0, fixed_ns = 0;
+        u32 num_hits = 0, matches = 0;
+        for (u32 base = 0, batch_ndx = 0; base < num_rays; base += batch_size, batch_ndx++)
+        {
+            const u32 n = vmath::min(batch_size, num_rays - base);
+            for (u32 i = 0; i < n; i++)
+            {
+                batch[i] = geometry::make_dda_ray(rays[base + i].ori, rays[base + i].dir);
+            }
+            for (u32 pass = 0; pass < 2; pass++)
+            {
+                const bool fixed = ((pass + batch_ndx) & 1) == 0;
+                const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+                for (u32 i = 0; i < n; i++)
+                {
+                    if (fixed) geometry::fixed_dda_isect(geometry::make_fixed_dda_ray(batch[i]), fixed_hits + i, skip_origin);
+                    else geometry::dda_isect(batch[i], float_hits + i, skip_origin);
+                }
+                (fixed ? fixed_ns : float_ns) += platform::osGetCurrentTimeNanoSeconds() - t0;
+            }
+            for (u32 i = 0; i < n; i++)
+            {
+                const geometry::traversal_hit& a = float_hits[i];
+                const geometry::traversal_hit& b = fixed_hits[i];
+                num_hits += b.hit ? 1 : 0;
+                matches += (a.hit == b.hit && (!a.hit || vmath::allEqualElements(a.voxel, b.voxel))) ? 1 : 0;
+            }
+        }
+        platform::osDebugLogFmt("[%s] %s rays: fixed-point traversal %f ns/ray vs %f ns/ray float (%fx, %u hits), %u/%u match float traversal \n",
+                                geometry::vol::brick_shape_name, ray_set_names[set], fixed_ns / denom, float_ns / denom,
+                                static_cast<double>(float_ns) / vmath::max(static_cast<double>(fixed_ns), 1.0), num_hits, matches, num_rays);
+    }
+
+    // Time bounce-ray binning (see [geometry::bin_key]); logs sorting cost against traversal in recorded vs. binned order, using the same
+    // batch size as the wavefront integrator
+    // Batches alternate which order runs first, so neither order consistently inherits a warm cache from the other
+    void time_binning(RAY_SETS set)
+    {
+        constexpr u32 batch_size = tracing::ray_queue::capacity;
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        u16 keys[batch_size];
+        u16 order[batch_size];
+        u16 scratch[batch_size];
+        geometry::traversal_hit hit;
+        u64 sort_ns = 0, unsorted_ns = 0, binned_ns = 0;
+        u32 unsorted_hits = 0, binned_hits = 0;
+        for (u32 base = 0, batch_ndx = 0; base < num_rays; base += batch_size, batch_ndx++)
+        {
+            const u32 n = vmath::min(batch_size, num_rays - base);
+            const bench_ray* batch = rays + base;
+            for (u32 pass = 0; pass < 2; pass++)
+            {
+                const bool binned_pass = (pass == (batch_ndx & 1));
+                const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+                if (binned_pass)
+                {
+                    for (u32 i = 0; i < n; i++)
+                    {
+                        keys[i] = geometry::bin_key(batch[i].ori, batch[i].dir);
+                    }
+                    geometry::bin_sort(keys, order, scratch, n);
+                }
+                const u64 t1 = platform::osGetCurrentTimeNanoSeconds();
+                u32 num_hits = 0;
+                for (u32 k = 0; k < n; k++)
+                {
+                    const u32 i = binned_pass ? order[k] : k;
+                    num_hits += geometry::dda_isect(geometry::make_dda_ray(batch[i].ori, batch[i].dir), &hit, true) ? 1 : 0;
+                }
+                const u64 t2 = platform::osGetCurrentTimeNanoSeconds();
+                if (binned_pass)
+                {
+                    sort_ns += t1 - t0;
+                    binned_ns += t2 - t1;
+                    binned_hits += num_hits;
+                }
+                else
+                {
+                    unsorted_ns += t2 - t1;
+                    unsorted_hits += num_hits;
+                }
+            }
+        }
+        const double denom = vmath::max(num_rays, 1u);
+        const double sort_cost = sort_ns / denom;
+        const double saved = (static_cast<double>(unsorted_ns) - static_cast<double>(binned_ns)) / denom;
+        platform::osDebugLogFmt("[%s] %s rays, binning: sort %f ns/ray, recorded order %f ns/ray (%u hits), binned order %f ns/ray (%u hits); %f ns/ray saved, %f ns/ray net \n",
+                                geometry::vol::brick_shape_name, ray_set_names[set], sort_cost, unsorted_ns / denom, unsorted_hits,
+                                binned_ns / denom, binned_hits, saved, saved - sort_cost);
+    }
+
+    // Time per-ray setup (bounds clamping, world->voxel mapping for origins & directions) with every term derived from
+    // [vol::metadata->transf] per-ray, against the same setup through the per-view transform block (see [geometry::vol::resolve_view])
+    void time_ray_setup(RAY_SETS set)
+    {
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set];
+        const geometry::vol::transform_nfo transf = geometry::vol::metadata->transf;
+        geometry::vol::view_transform view = geometry::vol::view;
+
+        // Accumulate outputs, so neither loop compiles away
+        vmath::vec<3> per_ray_uvw;
+        vmath::vec<3> block_uvw;
+        const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            const vmath::vec<3> extents = transf.scale * 0.5f;
+            const vmath::vec<3> ori = vmath::clamp(rays[i].ori, transf.pos - extents, transf.pos + extents);
+            const vmath::vec<3> rel_p = (ori - transf.pos) + extents;
+            const vmath::vec<3> uvw_scaled = (rel_p / transf.scale) * geometry::vol::width;
+            const vmath::vec<3> dir_scaled = (rays[i].dir / transf.scale) * geometry::vol::width;
+            per_ray_uvw += uvw_scaled + dir_scaled;
+        }
+        const u64 t1 = platform::osGetCurrentTimeNanoSeconds();
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            const vmath::vec<3> ori = vmath::clamp(rays[i].ori, view.bounds_min, view.bounds_max);
+            const vmath::vec<3> uvw_scaled = (ori * view.world_to_voxel_scale) + view.world_to_voxel_offs;
+            const vmath::vec<3> dir_scaled = rays[i].dir * view.world_to_voxel_scale;
+            block_uvw += uvw_scaled + dir_scaled;
+        }
+        const u64 t2 = platform::osGetCurrentTimeNanoSeconds();
+        const double denom = vmath::max(num_rays, 1u);
+        const vmath::vec<3> uvw_err = vmath::vabs(per_ray_uvw - block_uvw);
+        platform::osDebugLogFmt("[%s] %s rays, ray setup: per-ray transforms %f ns/ray, per-view block %f ns/ray (mean voxel-space difference %f) \n",
+                                geometry::vol::brick_shape_name, ray_set_names[set], (t1 - t0) / denom, (t2 - t1) / denom,
+                                (uvw_err.x() + uvw_err.y() + uvw_err.z()) / denom);
+    }
+
+    // Time exact single-ray traversal against 8-wide packet traversal over the same rays
+    // Packets are only meaningful for coherent sets, but timing both shows how much packets lose when coherence drops
+    void time_packets(RAY_SETS set)
+    {
+        const bench_ray* rays = ray_sets[set];
+        const u32 num_rays = ray_set_sizes[set] - (ray_set_sizes[set] % geometry::packet_width);
+        geometry::dda_ray dda_rays[geometry::packet_width];
+        geometry::traversal_hit hits[geometry::packet_width];
+
+        u32 single_hits = 0;
+        const u64 t0 = platform::osGetCurrentTimeNanoSeconds();
+        for (u32 i = 0; i < num_rays; i++)
+        {
+            const geometry::dda_ray r = geometry::make_dda_ray(rays[i].ori, rays[i].dir);
+            single_hits += geometry::dda_isect(r, hits, false) ? 1 : 0;
+        }
+        const u64 t1 = platform::osGetCurrentTimeNanoSeconds();
+
+        u32 packet_hits = 0;
+        for (u32 i = 0; i < num_rays; i += geometry::packet_width)
+        {
+            for (u32 j = 0; j < geometry::packet_width; j++)
+            {
+                dda_rays[j] = geometry::make_dda_ray(rays[i + j].ori, rays[i + j].dir);
+            }
+            geometry::packet_isect(dda_rays, 0xff, hits);
+            for (u32 j = 0; j < geometry::packet_width; j++)
+            {
+                packet_hits += hits[j].hit ? 1 : 0;
+            }
+        }
+        const u64 t2 = platform::osGetCurrentTimeNanoSeconds();
+
+        const double denom = vmath::max(num_rays, 1u);
+        platform::osDebugLogFmt("[%s] %s rays: single-ray exact %f ns/ray (%u hits), 8-wide packets %f ns/ray (%u hits) \n", geometry::vol::brick_shape_name,
+                                ray_set_names[set], static_cast<double>(t1 - t0) / denom, single_hits, static_cast<double>(t2 - t1) / denom, packet_hits);
+    }
+
+    // Record every ray set, then replay them against our traversal kernels
+    void traversal()
+    {
+        for (u32 i = 0; i < NUM_RAY_SETS; i++)
+        {
+            ray_sets[i] = mem::allocate_tracing<bench_ray>(sizeof(bench_ray) * max_rays_per_set);
+        }
+        record_primary_rays(ray_sets[COHERENT_PRIMARY], ray_set_sizes + COHERENT_PRIMARY);
+        record_bounce_rays(ray_sets[INCOHERENT_BOUNCE], ray_set_sizes + INCOHERENT_BOUNCE);
+        record_grazing_rays(ray_sets[GRAZING_BOUNCE], ray_set_sizes + GRAZING_BOUNCE);
+
+        platform::osDebugLogFmt("traversal benchmarks for brick shape [%s], %u metachunks \n", geometry::vol::brick_shape_name, geometry::vol::num_metachunks);
+        for (u32 i = 0; i < NUM_RAY_SETS; i++)
+        {
+            time_ray_setup(static_cast<RAY_SETS>(i));
+            time_cell_step(static_cast<RAY_SETS>(i));
+            time_dda(static_cast<RAY_SETS>(i));
+            compare_kernels(static_cast<RAY_SETS>(i));
+            time_packets(static_cast<RAY_SETS>(i));
+            time_occlusion(static_cast<RAY_SETS>(i));
+            time_segments(static_cast<RAY_SETS>(i));
+            time_interleaving(static_cast<RAY_SETS>(i));
+            time_crossing_masks(static_cast<RAY_SETS>(i));
+            time_octant_kernels(static_cast<RAY_SETS>(i));
+            time_fixed_point(static_cast<RAY_SETS>(i));
+            if (i != COHERENT_PRIMARY)
+            {
+                time_binning(static_cast<RAY_SETS>(i));
+            }
+        }
+
+        // Release ray sets, so benchmark memory doesn't stay resident while we render
+        for (u32 i = 0; i < NUM_RAY_SETS; i++)
+        {
+            mem::deallocate_tracing(sizeof(bench_ray) * max_rays_per_set);
+        }
+    }
+};
+
+#ifdef BENCH_DBG
+#pragma optimize("", on)
+#endif
@@ -33,12 +33,26 @@ struct sensel
     float b;
 };
 
+// Running sample statistics per-sensor, for adaptive sampling; mean/variance of each sample's luminance are tracked with
+// Welford's algorithm so they stay stable over long renders
+struct sensel_stats
+{
+    u32 num_samples;
+    float mean;
+    float m2;
+};
+
 export namespace camera
 {
     // Intermediate sensor values for filtering/anti-aliasing/temporal integration
     sensel* sensor_grid;
     constexpr u32 sensor_grid_footprint = ui::window_width * ui::window_height * sizeof(sensel);
 
+    // Sample statistics per-sensor (see [sensel_stats]); lets the tracer spend samples on the noisiest pixels
+    // instead of splitting them evenly over the whole image
+    sensel_stats* sensor_stats;
+    constexpr u32 sensor_stats_footprint = ui::window_width * ui::window_height * sizeof(sensel_stats);
+
     // Screen color/picture data (8bpc)
     u32* digital_colors;
     constexpr u32 digital_colors_footprint = ui::window_width * ui::window_height * sizeof(u32);
@@ -50,11 +64,17 @@ export namespace camera
     float* filter_sum_grid;
     constexpr u32 filter_sum_grid_footprint = ui::window_width * ui::window_height * sizeof(float);
 
+    // Sensor history for temporal reprojection; [store_history] snapshots sensors before their patch is cleared for a new view,
+    // then [reproject_sensor] folds snapshotted sensors back into whichever pixels their surfaces land on
+    sensel* history_grid;
+    float* history_filter_sums;
+    sensel_stats* history_stats;
+
     // Camera sampling! just perspective projection for now :)
     constexpr float FOV_RADS = vmath::pi * 0.5f;
-    const vmath::vec<3> camera_pos() { return vmath::vec<3>(0, 0, -10.0f); }
+    export const vmath::vec<3> camera_pos() { return vmath::vec<3>(0, 0, -10.0f); }
     const float camera_z_axis() { return (ui::window_width * aa::samples_x) / vmath::ftan(FOV_RADS * 0.5f); }
-    export tracing::path_vt lens_sample(u32 film_x, u32 film_y, float rand_u, float rand_v, float rho)
+    export tracing::path_vt lens_sample(u32 film_x, u32 film_y, float rand_u, float rand_v, spectra::lanes rho)
     {
         // Compute supersampled coordinates
         vmath::vec<2> film_xy = aa::supersample(float(film_x), float(film_y));
@@ -78,6 +98,19 @@ export namespace camera
                                               c, 1.0f, rho, 1.0f, 1.0f * filt);
     }
 
+    // Exact inverse of [lens_sample] (pinhole, measured from [camera_pos()]); returns continuous pixel coordinates, where rays through
+    // pixel (x, y) land in [x - 0.5, x + 0.5) and [y - 0.5, y + 0.5) after jitter
+    // [in_front_out] is cleared for points level with or behind the camera, which don't project meaningfully
+    export vmath::vec<2> project_to_film(vmath::vec<3> world_pos, bool* in_front_out)
+    {
+        const vmath::vec<3> rel = world_pos - camera_pos();
+        *in_front_out = rel.z() > 0.0001f;
+        if (!*in_front_out) return vmath::vec<2>(0.0f, 0.0f);
+        const float z_scale = camera_z_axis() / rel.z();
+        return vmath::vec<2>(((rel.x() * z_scale) + ui::image_centre_x * aa::samples_x) / aa::samples_x,
+                             ((rel.y() * z_scale) + ui::image_centre_y * aa::samples_y) / aa::samples_y);
+    }
+
     // Find the perspective-projected pixel coordinate passing through the given worldspace 3D coordinate
     export vmath::vec<2> inverse_lens_sample(vmath::vec<3> world_pos)
     {
@@ -131,30 +164,109 @@ export namespace camera
     // future versions will use a more sophisticated filter with no decay (so late samples will be implicitly
     // weighted the same as early ones) and I might eventually consider performing integration in spectral space
     // instead (not 100% sure what that would look like)
-    void sensor_response(float rho, float rho_weight, float pdf, float power, u32 ndx, u32 sample_num)
+    // [direct] carries light gathered separately from the path itself (e.g. sky NEE), already divided through by its pdfs
+    // Every wavelength lane in [rho] resolves through the film curve separately, then lanes average into one colour (see [spectra::film])
+    // Samples past [sample_cap] are dropped
+    void sensor_response(spectra::lanes rho, spectra::lanes rho_weight, float pdf, float power, u32 ndx, u32 sample_num, u32 sample_cap,
+                         spectra::lanes direct = 0.0f)
     {
         // Resolve responses per-channel
-        vmath::vec<3> rgb = spectra::film(rho) * rho_weight * (power / pdf);
+        vmath::vec<3> rgb = spectra::film(rho, (rho_weight * (power / pdf)) + direct);
+        const float luma = (rgb.e[0] * 0.2126f) + (rgb.e[1] * 0.7152f) + (rgb.e[2] * 0.0722f); // Rec. 709 weights
 
         // Compose isolated colours into a sensor value, apply accumulated weights
         // (from path-tracing + spectral integration), write to sensor output :)
         sensel& curr_sensel = sensor_grid[ndx]; // Read in current sensor value
+        sensel_stats& stats = sensor_stats[ndx];
         if (sample_num == 1)
         {
             curr_sensel.r = rgb.e[0];
             curr_sensel.g = rgb.e[1];
             curr_sensel.b = rgb.e[2];
+            stats.num_samples = 1;
+            stats.mean = luma;
+            stats.m2 = 0.0f;
         }
-        else if (sample_num < aa::max_samples)
+        else if (sample_num < sample_cap)
         {
             curr_sensel.r += rgb.e[0];
             curr_sensel.g += rgb.e[1];
             curr_sensel.b += rgb.e[2];
+            stats.num_samples++;
+            const float delta = luma - stats.mean;
+            stats.mean += delta / stats.num_samples;
+            stats.m2 += delta * (luma - stats.mean);
+        }
+    }
+
+    // Number of samples resolved into the sensor at [ndx] since it was last reset
+    u32 sensor_samples(u32 ndx)
+    {
+        return sensor_stats[ndx].num_samples;
+    }
+
+    // Mean luminance of the samples resolved into the sensor at [ndx]
+    float sensor_luma(u32 ndx)
+    {
+        const float mean = sensor_stats[ndx].mean;
+        return (mean == mean) ? mean : 0.0f; // Broken (NaN) samples shouldn't stall the rest of the tile
+    }
+
+    // Standard error of the mean luminance at [ndx]
+    float standard_error(u32 ndx)
+    {
+        const sensel_stats& stats = sensor_stats[ndx];
+        if (stats.num_samples < 2) return 0.0f;
+        const float variance = stats.m2 / (stats.num_samples - 1);
+        const float se = vmath::fsqrt(variance / stats.num_samples);
+        return (se == se) ? se : 0.0f; // As above
+    }
+
+    // Snapshot sensors in the given patch into [history_grid]/[history_filter_sums]/[history_stats]
+    void store_history(u32 xmin, u32 xmax, u32 ymin, u32 ymax)
+    {
+        u32 w = xmax - xmin;
+        for (u32 y = ymin; y < ymax; y++)
+        {
+            const u32 ndx = y * ui::window_width + xmin;
+            platform::osCpyMem(history_grid + ndx, sensor_grid + ndx, sizeof(sensel) * w);
+            platform::osCpyMem(history_filter_sums + ndx, filter_sum_grid + ndx, sizeof(float) * w);
+            platform::osCpyMem(history_stats + ndx, sensor_stats + ndx, sizeof(sensel_stats) * w);
         }
     }
 
+    // Fold the snapshotted sensor at [src_ndx] into the sensor at [dst_ndx], scaled by [confidence]
+    // Colors & filter sums scale together, so the history keeps its mean but counts for less against new samples; sample counts
+    // scale the same way (rounded, and capped at [sample_cap]), and sample statistics merge with Chan's parallel update
+    void reproject_sensor(u32 src_ndx, u32 dst_ndx, float confidence, u32 sample_cap)
+    {
+        const sensel_stats& src_stats = history_stats[src_ndx];
+        const u32 n_src = vmath::max(static_cast<u32>((src_stats.num_samples * confidence) + 0.5f), 1u);
+        const sensel& src = history_grid[src_ndx];
+        sensel& dst = sensor_grid[dst_ndx];
+        dst.r += src.r * confidence;
+        dst.g += src.g * confidence;
+        dst.b += src.b * confidence;
+        filter_sum_grid[dst_ndx] += history_filter_sums[src_ndx] * confidence;
+
+        sensel_stats& stats = sensor_stats[dst_ndx];
+        const float m2_src = (src_stats.num_samples > 1) ? src_stats.m2 * (static_cast<float>(n_src) / src_stats.num_samples) : 0.0f;
+        const u32 n = stats.num_samples + n_src;
+        const float delta = src_stats.mean - stats.mean;
+        stats.mean += delta * (static_cast<float>(n_src) / n);
+        stats.m2 += m2_src + (delta * delta * (static_cast<float>(stats.num_samples) * n_src / n));
+        stats.num_samples = vmath::min(n, sample_cap);
+    }
+
+    // Resolved color at [ndx] (accumulated samples over accumulated filter weights)
+    vmath::vec<3> sensor_rgb(u32 ndx)
+    {
+        const sensel sensor_v = sensor_grid[ndx] / filter_sum_grid[ndx];
+        return vmath::vec<3>(sensor_v.r, sensor_v.g, sensor_v.b);
+    }
+
     // Tonemap + write to digital output :)
-    export void tonemap_out(u32 ndx)
+    export void tonemap_out(u32 ndx, vmath::vec<3> rgb)
     {
         // Tonemap into integer 8bpc + return
         // Tonemapped with ACES, source:
@@ -168,16 +280,19 @@ export namespace camera
             const float e = 0.14f;
             return (x * (a * x + b)) / (x * (c * x + d) + e);
         };
-        sensel sensor_v = sensor_grid[ndx] / filter_sum_grid[ndx];
-        const u32 r = static_cast<u32>(aces(vmath::clamp(sensor_v.r, 0.0f, 1.0f)) * 256);
-        const u32 g = static_cast<u32>(aces(vmath::clamp(sensor_v.g, 0.0f, 1.0f)) * 256);
-        const u32 b = static_cast<u32>(aces(vmath::clamp(sensor_v.b, 0.0f, 1.0f)) * 256);
+        const u32 r = static_cast<u32>(aces(vmath::clamp(rgb.e[0], 0.0f, 1.0f)) * 256);
+        const u32 g = static_cast<u32>(aces(vmath::clamp(rgb.e[1], 0.0f, 1.0f)) * 256);
+        const u32 b = static_cast<u32>(aces(vmath::clamp(rgb.e[2], 0.0f, 1.0f)) * 256);
         const u32 a = 0x0;
         digital_colors[ndx] = b |
                              (g << 8) |
                              (r << 16) |
                              (a << 24);
     }
+    export void tonemap_out(u32 ndx)
+    {
+        tonemap_out(ndx, sensor_rgb(ndx));
+    }
 
     // Reconstruct sparse image data; useful if we want to undersample for faster renders
     // Current reconstruction uses bilinear interpolation, though other algorithms might be used in the future - the only
@@ -242,7 +357,11 @@ export namespace camera
 #endif
 #endif
 #endif
-            camera::digital_colors[ndxori++] = s;
+            if (sensor_stats[ndxori].num_samples == 0) // Sensors with their own samples (e.g. reprojected history) keep them
+            {
+                camera::digital_colors[ndxori] = s;
+            }
+            ndxori++;
         }
     }
 
@@ -297,7 +416,10 @@ export namespace camera
 #endif
 #endif
                 const u32 ndx = sample_y * ui::window_width + sample_x;
-                camera::digital_colors[ndx] = s; // Using the same trick as above, since we know our pixel band is constant
+                if (sensor_stats[ndx].num_samples == 0) // As above
+                {
+                    camera::digital_colors[ndx] = s; // Using the same trick as above, since we know our pixel band is constant
+                }
             }
         }
     }
@@ -311,6 +433,7 @@ export namespace camera
             platform::osClearMem(digital_colors + ndx, sizeof(u32) * w);
             platform::osClearMem(sensor_grid + ndx, sizeof(sensel) * w);
             platform::osClearMem(filter_sum_grid + ndx, sizeof(float) * w);
+            platform::osClearMem(sensor_stats + ndx, sizeof(sensel_stats) * w);
         }
     }
 
@@ -322,5 +445,10 @@ export namespace camera
         digital_colors = mem::allocate_tracing<u32>(digital_colors_footprint);
         filter_sum_grid = mem::allocate_tracing<float>(filter_sum_grid_footprint);
         platform::osClearMem(filter_sum_grid, filter_sum_grid_footprint);
+        sensor_stats = mem::allocate_tracing<sensel_stats>(sensor_stats_footprint);
+        platform::osClearMem(sensor_stats, sensor_stats_footprint);
+        history_grid = mem::allocate_tracing<sensel>(sensor_grid_footprint);
+        history_filter_sums = mem::allocate_tracing<float>(filter_sum_grid_footprint);
+        history_stats = mem::allocate_tracing<sensel_stats>(sensor_stats_footprint);
     }
 }
\ No newline at end of file
@@ -0,0 +1,428 @@
+export module denoise;
+
+#pragma once
+
+#include <immintrin.h>
+import ui;
+import aa;
+import mem;
+import vmath;
+import camera;
+import parallel;
+import platform;
+import vox_ints;
+
+//#define DENOISE_DBG
+#ifdef DENOISE_DBG
+#pragma optimize("", off)
+#endif
+
+// Edge-aware a-trous denoising for EDIT previews
+// SVGF-style wavelet filter (Schied et al. 2017, "Spatiotemporal Variance-Guided Filtering"): each iteration applies a small kernel
+// with its taps spread [2^i] pixels apart, and weights every tap by how closely its normal, depth and luminance match the centre
+// pixel; luminance differences are measured against the centre's (filtered) variance, so noise smooths away while shading edges survive
+// Normals & depths come from primary hits, resolved per-pixel by the tracer just before filtering (see [set_guide]); pixels without
+// hits get a fixed guide far behind the volume, so sky never blends into voxels
+// Filtering runs per-tile on the tracing threads, eight pixels at a time (AVX2), and ignores taps outside the tile; it works on
+// display-range (clamped) colors and only writes [camera::digital_colors], so sensors keep accumulating raw samples underneath; the
+// tracer stops tonemapping samples while filtering is enabled, so the screen only ever shows denoised output
+// Pixels skipped by EDIT strides are left out of the filter, then filled from their denoised neighbours afterwards
+#define ATROUS_DENOISING
+
+// Log filter timings (per-tile, and scaled up to a full window) every [timing_log_interval] filtered tiles
+//#define DENOISE_TIMINGS
+
+export namespace denoise
+{
+#ifdef ATROUS_DENOISING
+    constexpr bool enabled = true;
+#else
+    constexpr bool enabled = false;
+#endif
+    constexpr u32 num_iterations = 5;
+
+    // 3x3 binomial kernel, separable weights; the 5x5 B3-spline kernel from SVGF ([1/16, 1/4, 3/8, 1/4, 1/16]) filters about as well at
+    // EDIT sample counts, but costs almost three times as much
+    constexpr i32 kernel_radius = 1;
+    constexpr i32 kernel_width = (kernel_radius * 2) + 1;
+    constexpr u32 kernel_taps = kernel_width * kernel_width;
+    constexpr float kernel_1d[kernel_width] = { 0.25f, 0.5f, 0.25f };
+
+    constexpr float sigma_luma = 4.0f;
+    constexpr float sigma_depth = 2.0f; // Depth changes allowed per pixel of separation, in pixel footprints
+    constexpr u32 normal_power_log2 = 5; // Normal weights are [max(dot(n_p, n_q), 0)^32]
+    constexpr float sky_depth = 1000000.0f; // Guide depth for pixels without primary hits
+    constexpr float variance_min_pixels = 4.0f;
+    constexpr u32 max_variance_step = 8; // Widest spacing for variance estimates; matches the coarsest EDIT stride
+    constexpr i32 pad = kernel_radius << (num_iterations - 1); // Widest tap offset; working buffers keep this many empty pixels around each tile
+    constexpr u32 max_fill_sweeps = num_iterations - 1; // Hole-filling reaches as far as the second-widest filter iteration
+    constexpr double interval_ms = 33.0; // Minimum time between filtering the same tile (roughly one presented frame)
+    constexpr double max_time_share = 0.25; // Largest share of each tile's time spent filtering instead of sampling
+
+    // Guides, per-pixel
+    float* guide_depths = nullptr; // Distance from the camera
+    float* guide_normals[3] = {}; // Unit-length
+
+    void set_guide(u32 ndx, float depth, vmath::vec<3> normal)
+    {
+        guide_depths[ndx] = depth;
+        guide_normals[0][ndx] = normal.e[0];
+        guide_normals[1][ndx] = normal.e[1];
+        guide_normals[2][ndx] = normal.e[2];
+    }
+
+    void set_sky_guide(u32 ndx)
+    {
+        set_guide(ndx, sky_depth, vmath::vec<3>(0.0f, 0.0f, -1.0f));
+    }
+
+    // Padded working buffers, per-tile (SoA, [pitch] floats per row); colors & variances ping-pong between iterations
+    struct tile_buffers
+    {
+        float* r[2];
+        float* g[2];
+        float* b[2];
+        float* l[2]; // Luminance, kept alongside colors so taps don't recompute it
+        float* var[2];
+        float* depth;
+        float* nx;
+        float* ny;
+        float* nz;
+        float* valid; // 1 for pixels with samples, 0 for holes & padding
+        float* filled; // Hole-filling progress (see [fill_holes])
+    };
+    tile_buffers* tile_bufs = nullptr;
+    u32 pitch = 0; // Row width, in floats
+    u32 padded_rows = 0;
+    u32 tile_buffer_floats = 0;
+
+    // e^-x for x >= 0, to about four digits (plenty for filter weights)
+    // Splits -x * log2(e) into integer & fractional parts, then builds 2^int directly in the exponent bits and fits 2^frac with a cubic
+    __m256 exp_neg(__m256 x)
+    {
+        const __m256 t = _mm256_mul_ps(_mm256_min_ps(x, _mm256_set1_ps(80.0f)), _mm256_set1_ps(-1.44269504f));
+        const __m256 ti = _mm256_floor_ps(t);
+        const __m256 tf = _mm256_sub_ps(t, ti);
+        __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(0.0781693f), tf, _mm256_set1_ps(0.2262278f));
+        p = _mm256_fmadd_ps(p, tf, _mm256_set1_ps(0.6951786f));
+        p = _mm256_fmadd_ps(p, tf, _mm256_set1_ps(1.0f));
+        const __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(ti), _mm256_set1_epi32(127)), 23);
+        return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+    }
+
+    __m256 luma(__m256 r, __m256 g, __m256 b)
+    {
+        return _mm256_fmadd_ps(r, _mm256_set1_ps(0.2126f), _mm256_fmadd_ps(g, _mm256_set1_ps(0.7152f), _mm256_mul_ps(b, _mm256_set1_ps(0.0722f)))); // Rec. 709, same as
+                                                                                                                                                    // [camera::sensor_response]
+    }
+
+    // Load guides & display-range colors for the given tile, and estimate per-pixel luminance variance over 3x3 neighbourhoods (single
+    // pixels only have a handful of samples at EDIT rates, not enough for their own variance estimates)
+    // Neighbourhoods widen until they cover at least [variance_min_pixels] sampled pixels, so sparse EDIT strides still get estimates
+    void prepare(const tile_buffers& tb, i32 minX, i32 xMax, i32 minY, i32 yMax)
+    {
+        const i32 w = xMax - minX;
+        const i32 h = yMax - minY;
+        for (i32 y = 0; y < h; y++)
+        {
+            const u32 row_ndx = (minY + y) * ui::window_width + minX;
+            const u32 row_p = (y + pad) * pitch + pad;
+            platform::osCpyMem(tb.depth + row_p, guide_depths + row_ndx, sizeof(float) * w);
+            platform::osCpyMem(tb.nx + row_p, guide_normals[0] + row_ndx, sizeof(float) * w);
+            platform::osCpyMem(tb.ny + row_p, guide_normals[1] + row_ndx, sizeof(float) * w);
+            platform::osCpyMem(tb.nz + row_p, guide_normals[2] + row_ndx, sizeof(float) * w);
+            for (i32 x = 0; x < w; x++)
+            {
+                const u32 ndx = row_ndx + x;
+                const u32 p = row_p + x;
+                vmath::vec<3> rgb(0.0f);
+                tb.valid[p] = 0.0f;
+                if (camera::sensor_samples(ndx) > 0)
+                {
+                    rgb = camera::sensor_rgb(ndx);
+                    for (u8 c = 0; c < 3; c++)
+                    {
+                        rgb.e[c] = (rgb.e[c] == rgb.e[c]) ? vmath::clamp(rgb.e[c], 0.0f, 1.0f) : 0.0f; // Same clamp as [camera::tonemap_out];
+                                                                                                      // also drops broken (NaN) samples
+                    }
+                    tb.valid[p] = 1.0f;
+                }
+                tb.r[0][p] = rgb.e[0];
+                tb.g[0][p] = rgb.e[1];
+                tb.b[0][p] = rgb.e[2];
+                tb.l[0][p] = (rgb.e[0] * 0.2126f) + (rgb.e[1] * 0.7152f) + (rgb.e[2] * 0.0722f); // Rec. 709, same as [camera::sensor_response]
+                tb.filled[p] = 0.0f;
+            }
+        }
+
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (i32 y = 0; y < h; y++)
+        {
+            for (i32 x = 0; x < w; x += 8)
+            {
+                const u32 p = (y + pad) * pitch + (x + pad);
+                __m256 var_out = zero;
+                __m256 pending = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (u32 step = 1; step <= max_variance_step; step <<= 1)
+                {
+                    __m256 sum = zero, sum_sq = zero, num = zero;
+                    for (i32 dy = -1; dy <= 1; dy++)
+                    {
+                        for (i32 dx = -1; dx <= 1; dx++)
+                        {
+                            const u32 q = p + ((dy * pitch) + dx) * step;
+                            const __m256 l = _mm256_loadu_ps(tb.l[0] + q);
+                            const __m256 lv = _mm256_mul_ps(l, _mm256_loadu_ps(tb.valid + q));
+                            sum = _mm256_add_ps(sum, lv);
+                            sum_sq = _mm256_fmadd_ps(lv, l, sum_sq);
+                            num = _mm256_add_ps(num, _mm256_loadu_ps(tb.valid + q));
+                        }
+                    }
+                    const __m256 inv_num = _mm256_div_ps(one, _mm256_max_ps(num, one));
+                    const __m256 mean = _mm256_mul_ps(sum, inv_num);
+                    const __m256 var = _mm256_max_ps(_mm256_fmsub_ps(sum_sq, inv_num, _mm256_mul_ps(mean, mean)), zero);
+                    const __m256 resolved = _mm256_and_ps(pending, _mm256_cmp_ps(num, _mm256_set1_ps(variance_min_pixels), _CMP_GE_OQ));
+                    var_out = _mm256_blendv_ps(var_out, var, resolved);
+                    pending = _mm256_andnot_ps(resolved, pending);
+                    if (_mm256_movemask_ps(pending) == 0) break;
+                }
+                _mm256_storeu_ps(tb.var[0] + p, var_out);
+            }
+        }
+    }
+
+    // One a-trous iteration with taps [step] pixels apart, from buffer [src] into buffer [src ^ 1]
+    void filter_iteration(const tile_buffers& tb, i32 w, i32 h, u32 step, u32 src, float footprint_per_dist)
+    {
+        const u32 dst = src ^ 1;
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        const __m256 eps = _mm256_set1_ps(0.0001f);
+        const __m256 depth_tolerance = _mm256_set1_ps(sigma_depth * footprint_per_dist * step);
+
+        // Tap offsets & weights (the depth tolerance grows with distance from the centre)
+        i32 tap_offs[kernel_taps];
+        float tap_weights[kernel_taps];
+        float tap_inv_dists[kernel_taps];
+        for (i32 ty = 0; ty < kernel_width; ty++)
+        {
+            for (i32 tx = 0; tx < kernel_width; tx++)
+            {
+                const i32 t = ty * kernel_width + tx;
+                const i32 dx = tx - kernel_radius, dy = ty - kernel_radius;
+                tap_offs[t] = ((dy * static_cast<i32>(pitch)) + dx) * static_cast<i32>(step);
+                tap_weights[t] = kernel_1d[tx] * kernel_1d[ty];
+                tap_inv_dists[t] = (dx == 0 && dy == 0) ? 0.0f : 1.0f / vmath::fsqrt(static_cast<float>((dx * dx) + (dy * dy)));
+            }
+        }
+
+        for (i32 y = 0; y < h; y++)
+        {
+            for (i32 x = 0; x < w; x += 8)
+            {
+                const u32 p = (y + pad) * pitch + (x + pad);
+                const __m256 c_r = _mm256_loadu_ps(tb.r[src] + p);
+                const __m256 c_g = _mm256_loadu_ps(tb.g[src] + p);
+                const __m256 c_b = _mm256_loadu_ps(tb.b[src] + p);
+                const __m256 c_var = _mm256_loadu_ps(tb.var[src] + p);
+                const __m256 c_depth = _mm256_loadu_ps(tb.depth + p);
+                const __m256 c_nx = _mm256_loadu_ps(tb.nx + p);
+                const __m256 c_ny = _mm256_loadu_ps(tb.ny + p);
+                const __m256 c_nz = _mm256_loadu_ps(tb.nz + p);
+                const __m256 c_l = _mm256_loadu_ps(tb.l[src] + p);
+                const __m256 luma_scale = _mm256_div_ps(one, _mm256_fmadd_ps(_mm256_set1_ps(sigma_luma), _mm256_sqrt_ps(c_var), eps));
+                const __m256 depth_scale = _mm256_div_ps(one, _mm256_fmadd_ps(depth_tolerance, c_depth, eps));
+
+                __m256 sum_r = zero, sum_g = zero, sum_b = zero, sum_var = zero, sum_w = zero;
+                for (u32 t = 0; t < kernel_taps; t++)
+                {
+                    const u32 q = p + tap_offs[t];
+                    const __m256 q_valid = _mm256_loadu_ps(tb.valid + q);
+                    const __m256 q_r = _mm256_loadu_ps(tb.r[src] + q);
+                    const __m256 q_g = _mm256_loadu_ps(tb.g[src] + q);
+                    const __m256 q_b = _mm256_loadu_ps(tb.b[src] + q);
+
+                    // Normal weight
+                    __m256 w_n = _mm256_fmadd_ps(c_nx, _mm256_loadu_ps(tb.nx + q),
+                                 _mm256_fmadd_ps(c_ny, _mm256_loadu_ps(tb.ny + q),
+                                 _mm256_mul_ps(c_nz, _mm256_loadu_ps(tb.nz + q))));
+                    w_n = _mm256_max_ps(w_n, zero);
+                    for (u32 i = 0; i < normal_power_log2; i++)
+                    {
+                        w_n = _mm256_mul_ps(w_n, w_n);
+                    }
+
+                    // Depth & luminance weights share one exponential
+                    const __m256 d_depth = _mm256_and_ps(_mm256_sub_ps(c_depth, _mm256_loadu_ps(tb.depth + q)), abs_mask);
+                    const __m256 d_luma = _mm256_and_ps(_mm256_sub_ps(c_l, _mm256_loadu_ps(tb.l[src] + q)), abs_mask);
+                    const __m256 arg = _mm256_fmadd_ps(_mm256_mul_ps(d_depth, depth_scale), _mm256_set1_ps(tap_inv_dists[t]), _mm256_mul_ps(d_luma, luma_scale));
+                    const __m256 w = _mm256_mul_ps(_mm256_mul_ps(exp_neg(arg), w_n), _mm256_mul_ps(q_valid, _mm256_set1_ps(tap_weights[t])));
+
+                    sum_r = _mm256_fmadd_ps(w, q_r, sum_r);
+                    sum_g = _mm256_fmadd_ps(w, q_g, sum_g);
+                    sum_b = _mm256_fmadd_ps(w, q_b, sum_b);
+                    sum_var = _mm256_fmadd_ps(_mm256_mul_ps(w, w), _mm256_loadu_ps(tb.var[src] + q), sum_var);
+                    sum_w = _mm256_add_ps(sum_w, w);
+                }
+
+                // Pixels without any weight (holes, padding) pass through unchanged
+                const __m256 weighted = _mm256_cmp_ps(sum_w, zero, _CMP_GT_OQ);
+                const __m256 inv_w = _mm256_div_ps(one, _mm256_blendv_ps(one, sum_w, weighted));
+                const __m256 out_r = _mm256_blendv_ps(c_r, _mm256_mul_ps(sum_r, inv_w), weighted);
+                const __m256 out_g = _mm256_blendv_ps(c_g, _mm256_mul_ps(sum_g, inv_w), weighted);
+                const __m256 out_b = _mm256_blendv_ps(c_b, _mm256_mul_ps(sum_b, inv_w), weighted);
+                _mm256_storeu_ps(tb.r[dst] + p, out_r);
+                _mm256_storeu_ps(tb.g[dst] + p, out_g);
+                _mm256_storeu_ps(tb.b[dst] + p, out_b);
+                _mm256_storeu_ps(tb.l[dst] + p, luma(out_r, out_g, out_b));
+                _mm256_storeu_ps(tb.var[dst] + p, _mm256_blendv_ps(c_var, _mm256_mul_ps(sum_var, _mm256_mul_ps(inv_w, inv_w)), weighted));
+            }
+        }
+    }
+
+    // Fill holes from the kernel-weighted average of their filtered neighbours, [step] pixels apart; holes filled by an earlier
+    // sweep are kept, and never count as neighbours themselves
+    // Returns the number of holes still empty
+    u32 fill_holes(const tile_buffers& tb, i32 w, i32 h, u32 step, u32 buf)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        u32 num_empty = 0;
+        for (i32 y = 0; y < h; y++)
+        {
+            for (i32 x = 0; x < w; x += 8)
+            {
+                const u32 p = (y + pad) * pitch + (x + pad);
+                const __m256 pending = _mm256_cmp_ps(_mm256_add_ps(_mm256_loadu_ps(tb.valid + p), _mm256_loadu_ps(tb.filled + p)), zero, _CMP_EQ_OQ);
+                if (_mm256_movemask_ps(pending) == 0) continue;
+
+                __m256 sum_r = zero, sum_g = zero, sum_b = zero, sum_w = zero;
+                for (i32 ty = 0; ty < kernel_width; ty++)
+                {
+                    for (i32 tx = 0; tx < kernel_width; tx++)
+                    {
+                        const u32 q = p + (((ty - kernel_radius) * static_cast<i32>(pitch)) + (tx - kernel_radius)) * static_cast<i32>(step);
+                        const __m256 w = _mm256_mul_ps(_mm256_loadu_ps(tb.valid + q), _mm256_set1_ps(kernel_1d[tx] * kernel_1d[ty]));
+                        sum_r = _mm256_fmadd_ps(w, _mm256_loadu_ps(tb.r[buf] + q), sum_r);
+                        sum_g = _mm256_fmadd_ps(w, _mm256_loadu_ps(tb.g[buf] + q), sum_g);
+                        sum_b = _mm256_fmadd_ps(w, _mm256_loadu_ps(tb.b[buf] + q), sum_b);
+                        sum_w = _mm256_add_ps(sum_w, w);
+                    }
+                }
+                const __m256 fill = _mm256_and_ps(pending, _mm256_cmp_ps(sum_w, zero, _CMP_GT_OQ));
+                const __m256 inv_w = _mm256_div_ps(one, _mm256_blendv_ps(one, sum_w, fill));
+                _mm256_storeu_ps(tb.r[buf] + p, _mm256_blendv_ps(_mm256_loadu_ps(tb.r[buf] + p), _mm256_mul_ps(sum_r, inv_w), fill));
+                _mm256_storeu_ps(tb.g[buf] + p, _mm256_blendv_ps(_mm256_loadu_ps(tb.g[buf] + p), _mm256_mul_ps(sum_g, inv_w), fill));
+                _mm256_storeu_ps(tb.b[buf] + p, _mm256_blendv_ps(_mm256_loadu_ps(tb.b[buf] + p), _mm256_mul_ps(sum_b, inv_w), fill));
+                _mm256_storeu_ps(tb.filled + p, _mm256_blendv_ps(_mm256_loadu_ps(tb.filled + p), one, fill));
+
+                // Lanes past the tile edge are padding, not holes
+                const u32 lanes_in_tile = vmath::min(w - x, 8);
+                num_empty += _mm_popcnt_u32(_mm256_movemask_ps(_mm256_andnot_ps(fill, pending)) & ((1u << lanes_in_tile) - 1));
+            }
+        }
+        return num_empty;
+    }
+
+#ifdef DENOISE_TIMINGS
+    constexpr u32 timing_log_interval = 64;
+    double timing_ms = 0.0;
+    u64 timing_pixels = 0;
+    u32 timing_tiles = 0;
+#endif
+
+    // Denoise the given tile into [camera::digital_colors]; expects guides to be set for every pixel in the tile
+    void filter_tile(u32 tileNdx, i32 minX, i32 xMax, i32 minY, i32 yMax)
+    {
+#ifdef DENOISE_TIMINGS
+        const double t0 = platform::osGetCurrentTimeMilliSeconds();
+#endif
+        const tile_buffers& tb = tile_bufs[tileNdx];
+        const i32 w = xMax - minX;
+        const i32 h = yMax - minY;
+        prepare(tb, minX, xMax, minY, yMax);
+
+        const float footprint_per_dist = aa::samples_x / camera::camera_z_axis(); // Worldspace pixel width per unit distance from the camera
+        u32 buf = 0;
+        for (u32 i = 0; i < num_iterations; i++)
+        {
+            filter_iteration(tb, w, h, 1u << i, buf, footprint_per_dist);
+            buf ^= 1;
+        }
+        for (u32 i = 0; i < max_fill_sweeps; i++)
+        {
+            if (fill_holes(tb, w, h, 1u << i, buf) == 0) break;
+        }
+
+        for (i32 y = 0; y < h; y++)
+        {
+            for (i32 x = 0; x < w; x++)
+            {
+                const u32 p = (y + pad) * pitch + (x + pad);
+                if (tb.valid[p] > 0.0f || tb.filled[p] > 0.0f)
+                {
+                    camera::tonemap_out((minY + y) * ui::window_width + (minX + x), vmath::vec<3>(tb.r[buf][p], tb.g[buf][p], tb.b[buf][p]));
+                }
+            }
+        }
+
+#ifdef DENOISE_TIMINGS
+        // Per-thread timings are summed here without synchronization; close enough for a debug log
+        timing_ms += platform::osGetCurrentTimeMilliSeconds() - t0;
+        timing_pixels += static_cast<u64>(w) * h;
+        if (++timing_tiles % timing_log_interval == 0)
+        {
+            const double ms_per_window = (timing_ms / timing_pixels) * ui::window_area;
+            platform::osDebugLogFmt("a-trous denoising: %f ms per tile, %f ms per %ix%i frame (one thread), %f ms over %i threads\n",
+                                    timing_ms / timing_tiles, ms_per_window, ui::window_width, ui::window_height,
+                                    ms_per_window / parallel::numTiles, parallel::numTiles);
+        }
+#endif
+    }
+
+    // Allocate guides & per-tile working buffers, sized for the largest tile [tracing::trace] can produce
+    void init()
+    {
+        guide_depths = mem::allocate_tracing<float>(sizeof(float) * ui::window_area);
+        for (u8 i = 0; i < 3; i++)
+        {
+            guide_normals[i] = mem::allocate_tracing<float>(sizeof(float) * ui::window_area);
+        }
+
+        pitch = ((((ui::window_width / parallel::numTilesX) + 1) + (pad * 2)) + 7) & ~7u;
+        padded_rows = ((ui::window_height / parallel::numTilesY) + 1) + (pad * 2);
+        tile_buffer_floats = pitch * padded_rows;
+        tile_bufs = mem::allocate_tracing<tile_buffers>(sizeof(tile_buffers) * parallel::numTiles);
+        auto alloc = []()
+        {
+            float* buf = mem::allocate_tracing<float>(sizeof(float) * tile_buffer_floats);
+            platform::osClearMem(buf, sizeof(float) * tile_buffer_floats); // Padding never holds valid pixels, but still needs finite values
+                                                                           // (taps there are weighted by zero)
+            return buf;
+        };
+        for (u32 i = 0; i < parallel::numTiles; i++)
+        {
+            tile_buffers& tb = tile_bufs[i];
+            for (u8 j = 0; j < 2; j++)
+            {
+                tb.r[j] = alloc();
+                tb.g[j] = alloc();
+                tb.b[j] = alloc();
+                tb.l[j] = alloc();
+                tb.var[j] = alloc();
+            }
+            tb.depth = alloc();
+            tb.nx = alloc();
+            tb.ny = alloc();
+            tb.nz = alloc();
+            tb.valid = alloc();
+            tb.filled = alloc();
+        }
+    }
+};
+
+#ifdef DENOISE_DBG
+#pragma optimize("", on)
+#endif
@@ -1,7 +1,14 @@
 
 import geometry;
+import platform;
 import vox_ints;
 
-u8* geometry::vol::metachunk_occupancies;
+geometry::vol::metachunk::occupancy_mask* geometry::vol::metachunk_occupancies;
 geometry::vol::metachunk* geometry::vol::metachunks;
-geometry::vol::vol_nfo* geometry::vol::metadata;
\ No newline at end of file
+geometry::vol::vol_nfo* geometry::vol::metadata;
+platform::threads::osAtomicInt* geometry::vol::view_version = nullptr;
+platform::threads::osAtomicInt* geometry::vol::volume_version = nullptr;
+geometry::vol::view_transform geometry::vol::view;
+u64* geometry::vol::solid_metachunks;
+u16* geometry::vol::occupied_coarse_bricks;
+u32 geometry::vol::num_occupied_coarse_bricks;
\ No newline at end of file
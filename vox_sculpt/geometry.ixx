@@ -2,6 +2,7 @@ export module geometry;
 
 #pragma once
 
+#include <immintrin.h>
 import vmath;
 import materials;
 import mem;
@@ -17,6 +18,12 @@ import vox_ints;
 
 namespace geometry
 {
+    // Integer log2 for power-of-two sizes, used to turn DDA scales into shifts
+    constexpr u32 ilog2(u32 v)
+    {
+        return (v > 1) ? 1 + ilog2(v >> 1) : 0;
+    }
+
     export struct vol
     {
         static constexpr u32 width = 1024; // All volumes are 1024 * 1024 * 1024
@@ -43,9 +50,41 @@ namespace geometry
         };
         static vol_nfo* metadata;
 
+        // Version counters for cached traversal results (see [primary_hit_cache]); views advance on every spin/zoom, volumes advance
+        // whenever voxel data changes
+        // Spins/zooms land on the main thread while tiles are tracing, so both counters are atomic; [resolve_view] publishes the view
+        // before advancing [view_version], and tracers read versions before the view, so results traced across an update are always
+        // tagged with the older version (and go stale instead of passing for the new view)
+        static platform::threads::osAtomicInt* view_version;
+        static platform::threads::osAtomicInt* volume_version;
+        static u32 scene_version() // Both counters only ever increase, so any update changes the sum
+        {
+            return static_cast<u32>(view_version->load() + volume_version->load());
+        }
+
+        // Per-view transform block; everything per-ray setup needs from [metadata->transf], resolved once per spin/zoom (see [resolve_view])
+        // instead of once per ray
+        // World->voxel mapping is [p * world_to_voxel_scale + world_to_voxel_offs], voxel->world mapping is the reverse
+        struct view_transform
+        {
+            vmath::vec<3> bounds_min; // Worldspace bounding-box
+            vmath::vec<3> bounds_max;
+            vmath::vec<3> world_to_voxel_scale; // [width / scale]; also maps worldspace directions into voxel space
+            vmath::vec<3> world_to_voxel_offs;
+            vmath::vec<3> voxel_to_world_scale; // [scale / width]
+            vmath::vec<3> voxel_to_world_offs;
+
+            // Worldspace position of the (continuous) voxel coordinate [voxel]; same mapping traversal uses to leave the grid
+            vmath::vec<3> voxel_to_world(vmath::vec<3> voxel) const
+            {
+                return (voxel * voxel_to_world_scale) + voxel_to_world_offs;
+            }
+        };
+        static view_transform view;
+
         // Our geometry is composed of individual bits, grouped into 64-bit chunks;
-        // metachunks take that abstraction one layer higher by providing groups of 2x2x2
-        // chunks for efficient traversal (one metachunk is one cacheline)
+        // metachunks take that abstraction one layer higher by providing groups of
+        // chunks for efficient traversal (the default 2x2x2 metachunk is one cacheline)
         // Individual voxels (within chunks) occupy one bit each; order is left-right/front-back/top-bottom
         // front view:
         // 00 01 02 03
@@ -63,21 +102,43 @@ namespace geometry
         // 56 57 58 59
         // 60 61 62 63
         // We evaluate these cells by constructing a 64-bit mask for the one we want to test; if the current chunk AND the mask is nonzero, we have a set cell, otherwise we have an empty one
-        static u8* metachunk_occupancies; // Direct mask of occupancies per-metachunk, for faster testing during chunk/metachunk traversal
-        struct metachunk
+        // (the diagrams above are for 4x4x4 chunks; other brick shapes keep the same x-then-y-then-z bit order)
+
+        // Occupancy masks carry one bit per chunk in each metachunk, so larger metachunks need wider masks
+        template<u32 num_chunks>
+        struct occupancy_type { typedef u64 type; };
+        template<u32 num_chunks> requires (num_chunks <= 8)
+        struct occupancy_type<num_chunks> { typedef u8 type; };
+        template<u32 num_chunks> requires (num_chunks > 8 && num_chunks <= 16)
+        struct occupancy_type<num_chunks> { typedef u16 type; };
+        template<u32 num_chunks> requires (num_chunks > 16 && num_chunks <= 32)
+        struct occupancy_type<num_chunks> { typedef u32 type; };
+
+        // Generic brick shape; metachunk dimensions in chunks come first, then chunk dimensions in voxels
+        // Chunks are always one u64, so chunk dimensions have to multiply out to 64 voxels; every dimension should be a power of two
+        // so that index solvers and DDA level scales reduce to shifts/masks
+        template<u32 _res_x, u32 _res_y, u32 _res_z,
+                 u32 _chunk_res_x, u32 _chunk_res_y, u32 _chunk_res_z>
+        struct metachunk_shape
         {
             // Metachunk dimensions in chunks
-            static constexpr u32 res_x = 2;
-            static constexpr u32 res_y = 2;
-            static constexpr u32 res_z = 2;
+            static constexpr u32 res_x = _res_x;
+            static constexpr u32 res_y = _res_y;
+            static constexpr u32 res_z = _res_z;
             static constexpr u32 res_xy = res_x * res_y;
             static constexpr u32 res = res_xy * res_z;
 
             // Chunk dimensions in voxels
-            static constexpr u32 chunk_res_x = 4;
-            static constexpr u32 chunk_res_y = 4;
-            static constexpr u32 chunk_res_z = 4;
+            static constexpr u32 chunk_res_x = _chunk_res_x;
+            static constexpr u32 chunk_res_y = _chunk_res_y;
+            static constexpr u32 chunk_res_z = _chunk_res_z;
             static constexpr u32 chunk_res_xy = chunk_res_x * chunk_res_y;
+            static constexpr u32 chunk_res = chunk_res_xy * chunk_res_z;
+            static_assert(chunk_res == 64, "chunks are stored as single u64s, so every chunk shape needs exactly 64 voxels");
+            static_assert(res <= 64, "metachunk occupancies are stored as (at most) 64-bit masks");
+            static_assert((_res_x & (_res_x - 1)) == 0 && (_res_y & (_res_y - 1)) == 0 && (_res_z & (_res_z - 1)) == 0 &&
+                          (_chunk_res_x & (_chunk_res_x - 1)) == 0 && (_chunk_res_y & (_chunk_res_y - 1)) == 0 && (_chunk_res_z & (_chunk_res_z - 1)) == 0,
+                          "brick dimensions need to be powers of two");
 
             // Metachunk dimensions in voxels
             static constexpr u32 num_vox_x = res_x * chunk_res_x;
@@ -86,15 +147,75 @@ namespace geometry
             static constexpr u32 num_vox_xy = num_vox_x * num_vox_y;
             static constexpr u32 num_vox = num_vox_xy * num_vox_z;
 
+            // Per-metachunk occupancy masks (one bit per chunk)
+            typedef typename occupancy_type<res>::type occupancy_mask;
+            static constexpr u64 occupancy_bits = (res == 64) ? ~0ull : ((1ull << res) - 1); // Valid bits within each occupancy mask
+
             // Metachunk data
             u64 chunks[res];
+
+            // Fill every chunk with the same byte pattern (used by the solid test volumes)
+            void batch_assign(u8 byte_pattern)
+            {
+                const u64 pattern = static_cast<u64>(byte_pattern) * 0x0101010101010101ull;
+                for (u32 i = 0; i < res; i++)
+                {
+                    chunks[i] = pattern;
+                }
+            }
         };
+
+        // Brick shape selection; only one of these should be active at a time
+        // (each shape is a separate build, so benchmarks in [bench.ixx] report whichever shape was compiled in)
+#define BRICK_SHAPE_2x2x2_4x4x4
+//#define BRICK_SHAPE_2x2x2_8x8x1
+//#define BRICK_SHAPE_4x4x4_4x4x4
+//#define BRICK_SHAPE_2x2x2_4x4x4_METACHUNKS_4x4x2
+#ifdef BRICK_SHAPE_2x2x2_4x4x4
+        typedef metachunk_shape<2, 2, 2, 4, 4, 4> metachunk; // One cacheline per metachunk
+        static constexpr const char* brick_shape_name = "2x2x2 chunks, 4x4x4 voxels/chunk";
+#elif defined(BRICK_SHAPE_2x2x2_8x8x1)
+        typedef metachunk_shape<2, 2, 2, 8, 8, 1> metachunk; // Flat rows, one voxel deep per chunk
+        static constexpr const char* brick_shape_name = "2x2x2 chunks, 8x8x1 voxels/chunk";
+#elif defined(BRICK_SHAPE_4x4x4_4x4x4)
+        typedef metachunk_shape<4, 4, 4, 4, 4, 4> metachunk; // Eight cachelines per metachunk, 64-bit occupancy masks
+        static constexpr const char* brick_shape_name = "4x4x4 chunks, 4x4x4 voxels/chunk";
+#elif defined(BRICK_SHAPE_2x2x2_4x4x4_METACHUNKS_4x4x2)
+        typedef metachunk_shape<4, 4, 2, 4, 4, 4> metachunk; // Four cachelines per metachunk, wide & shallow
+        static constexpr const char* brick_shape_name = "4x4x2 chunks, 4x4x4 voxels/chunk";
+#endif
+        static_assert(width % metachunk::num_vox_x == 0 &&
+                      width % metachunk::num_vox_y == 0 &&
+                      width % metachunk::num_vox_z == 0, "metachunks need to tile the volume grid exactly");
+        static metachunk::occupancy_mask* metachunk_occupancies; // Direct mask of occupancies per-metachunk, for faster testing during chunk/metachunk traversal
+
+        // Per-axis DDA step sizes for each traversal level (metachunk, chunk, voxel), and their log2 (brick dimensions are powers of two, so
+        // cell coordinates at every level reduce to shifts)
+        static constexpr u32 dda_scales[3][3] = { { metachunk::num_vox_x, metachunk::num_vox_y, metachunk::num_vox_z },
+                                                  { metachunk::chunk_res_x, metachunk::chunk_res_y, metachunk::chunk_res_z },
+                                                  { 1, 1, 1 } };
+        static constexpr u32 dda_shifts[3][3] = { { ilog2(metachunk::num_vox_x), ilog2(metachunk::num_vox_y), ilog2(metachunk::num_vox_z) },
+                                                  { ilog2(metachunk::chunk_res_x), ilog2(metachunk::chunk_res_y), ilog2(metachunk::chunk_res_z) },
+                                                  { 0, 0, 0 } };
         static constexpr u32 num_metachunks_x = width / metachunk::num_vox_x;
         static constexpr u32 num_metachunks_y = width / metachunk::num_vox_y;
         static constexpr u32 num_metachunks_z = width / metachunk::num_vox_z;
         static constexpr u32 num_metachunks_xy = num_metachunks_x * num_metachunks_y;
         static constexpr u32 num_metachunks = num_metachunks_xy * num_metachunks_z;
         static metachunk* metachunks;
+        static u64* solid_metachunks; // One bit per-metachunk, set when every voxel inside is filled (any-hit queries treat those as instant hits)
+        static constexpr u32 num_solid_metachunk_words = (num_metachunks + 63) / 64;
+
+        // Coarse bricks for screen-space prepasses (see [tracing::brick_depth_prepass]); each covers [coarse_brick_width]^3 voxels, and
+        // we list every brick containing at least one occupied metachunk
+        static constexpr u32 coarse_brick_width = 64;
+        static constexpr u32 num_coarse_bricks_per_axis = width / coarse_brick_width;
+        static constexpr u32 num_coarse_bricks = num_coarse_bricks_per_axis * num_coarse_bricks_per_axis * num_coarse_bricks_per_axis;
+        static_assert(coarse_brick_width % metachunk::num_vox_x == 0 &&
+                      coarse_brick_width % metachunk::num_vox_y == 0 &&
+                      coarse_brick_width % metachunk::num_vox_z == 0, "coarse bricks need to contain whole metachunks");
+        static u16* occupied_coarse_bricks; // Flattened brick indices, x-then-y-then-z like everything else
+        static u32 num_occupied_coarse_bricks;
         static u32 chunk_index_solver(vmath::vec<3, i32> uvw_floored) // Returns chunk index
         {
             // Scalarized logic to reduce vec<n> constructor calls
@@ -142,7 +263,7 @@ namespace geometry
             vmath::vec<3, i32> voxel_uvw = vmath::vec<3, i32>(uvw_floored.x() % metachunk::chunk_res_x,
                                                               uvw_floored.y() % metachunk::chunk_res_y,
                                                               uvw_floored.z() % metachunk::chunk_res_z);
-            voxel_uvw *= vmath::vec<3, i32>(1, metachunk::chunk_res_y, metachunk::chunk_res_xy);
+            voxel_uvw *= vmath::vec<3, i32>(1, metachunk::chunk_res_x, metachunk::chunk_res_xy);
             ret.bitmask = ((1ull << voxel_uvw.z()) << voxel_uvw.y()) << voxel_uvw.x();
 
             // Compute chunk/metachunk indices
@@ -171,6 +292,30 @@ namespace geometry
             return static_cast<u32>(res);
         }
 
+        // Rebuild [view] from the current volume transform, then advance [view_version] so tracers drop anything cached against the
+        // previous view
+        // The block is resolved locally and published with a single copy, so tracers never see bounds from one view mixed with
+        // voxel mappings from another
+        // Traversal doesn't apply the volume orientation yet (spins only reach [metadata->transf]), so there's no rotation to resolve here
+        static void resolve_view()
+        {
+            const transform_nfo& transf = metadata->transf;
+            view_transform v;
+
+            // Bounds & world<->voxel mappings
+            const vmath::vec<3> extents = transf.scale * 0.5f;
+            v.bounds_min = transf.pos - extents;
+            v.bounds_max = transf.pos + extents;
+            v.world_to_voxel_scale = vmath::vec<3>(static_cast<float>(width)) / transf.scale;
+            v.world_to_voxel_offs = (extents - transf.pos) * v.world_to_voxel_scale;
+            v.voxel_to_world_scale = transf.scale / static_cast<float>(width);
+            v.voxel_to_world_offs = v.bounds_min;
+
+            // Publish
+            view = v;
+            view_version->inc();
+        }
+
         // Resolve screen-space volume bounds for the current camera transform
         // (inverse lens sampling performed on the camera, so this just needs to resolve worldspace bounds and reproject them that way, before
         // taking the min/max coordinates in the 2D plane and storing those)
@@ -253,12 +398,14 @@ namespace geometry
 #define TEST_NOISE_CUBE
 //#define TEST_SOLID_CUBE
 //#define TEST_SOLID_SPHERE
-#if !defined(TEST_SOLID_CUBE) && !defined(TEST_SOLID_SPHERE)
+//#define TEST_CAVITY_SPHERE // Solid sphere carved by a lattice of spherical cavities; cavities crossing the surface open into deep pits lit
+                             // mostly by interreflection (test scene for bidirectional rendering)
+#if !defined(TEST_SOLID_CUBE) && !defined(TEST_SOLID_SPHERE) && !defined(TEST_CAVITY_SPHERE)
         float sample[8];
 #endif
         for (u32 i = metachunk_ndx_min; i < metachunk_ndx_max; i++)
         {
-#ifndef TEST_SOLID_SPHERE
+#if !defined(TEST_SOLID_SPHERE) && !defined(TEST_CAVITY_SPHERE)
 #ifndef TEST_NOISE_CUBE
 #ifndef TEST_SOLID_CUBE
             const vmath::vec<3> uvw = vol::expand_ndx<vol::num_metachunks_x, vol::num_metachunks_xy>(i);
@@ -269,6 +416,7 @@ namespace geometry
                 parallel::rand_streams[tile_ndx].next(sample);
                 parallel::rand_streams[tile_ndx].next(sample + 4);
                 u64* chunks = vol::metachunks[i].chunks;
+                // (the commented-out patterns below assume 2x2x2 metachunks)
 
                 // Fuzzy version of the metachunk sphere above, with occasional fireflies
                 float t = 1.0f - (vmath::fabs(d) / r2);
@@ -276,14 +424,15 @@ namespace geometry
                 const double soften = vmath::lerp<double>(static_cast<double>(0x33333333), static_cast<double>(0xffffffff), t);
                 u64 soften_fac = static_cast<u64>(soften);
                 soften_fac |= 0xffffffffull << 4ull;
-                chunks[0] = static_cast<u64>(sample[0] * 0xffffffffffffffff) | soften_fac;
-                chunks[1] = static_cast<u64>(sample[1] * 0xffffffffffffffff) | soften_fac;
-                chunks[2] = static_cast<u64>(sample[2] * 0xffffffffffffffff) | soften_fac;
-                chunks[3] = static_cast<u64>(sample[3] * 0xffffffffffffffff) | soften_fac;
-                chunks[4] = static_cast<u64>(sample[4] * 0xffffffffffffffff) | soften_fac;
-                chunks[5] = static_cast<u64>(sample[5] * 0xffffffffffffffff) | soften_fac;
-                chunks[6] = static_cast<u64>(sample[6] * 0xffffffffffffffff) | soften_fac;
-                chunks[7] = static_cast<u64>(sample[7] * 0xffffffffffffffff) | soften_fac;
+                for (u32 j = 0; j < vol::metachunk::res; j++)
+                {
+                    if (j > 0 && (j % 8) == 0)
+                    {
+                        parallel::rand_streams[tile_ndx].next(sample);
+                        parallel::rand_streams[tile_ndx].next(sample + 4);
+                    }
+                    chunks[j] = static_cast<u64>(sample[j % 8] * 0xffffffffffffffff) | soften_fac;
+                }
 
                 // Fuzzy plus sign
                 //chunks[0] = static_cast<u64>(sample[0] * 0xffffffffffffffff) | 0x7777ffffffffffff;
@@ -319,51 +468,158 @@ namespace geometry
             // Structural noise for clumping effects without excessively fine detail
             // (which was sampled out in prior versions)
 
-            // Generate random values
-            parallel::rand_streams[tile_ndx].next(sample);
-            parallel::rand_streams[tile_ndx].next(sample + 4);
-
-            // Modulate first four chunks (first RNG tap)
-            chunks[0] = static_cast<u64>(sample[0] * 0xffffffffffffffff) & 0x7fffffffffffffff;
-            chunks[1] = static_cast<u64>(sample[1] * 0xffffffffffffffff) & 0x7fffffffffffffff;
-            chunks[2] = static_cast<u64>(sample[2] * 0xffffffffffffffff) & 0x7fffffffffffffff;
-            chunks[3] = static_cast<u64>(sample[3] * 0xffffffffffffffff) & 0x7fffffffffffffff;
-
-            // Modulate next four chunks (second RNG tap)
-            chunks[4] = static_cast<u64>(sample[4] * 0xffffffffffffffff) | 0x7fffffffffffffff;
-            chunks[5] = static_cast<u64>(sample[5] * 0xffffffffffffffff) | 0x7fffffffffffffff;
-            chunks[6] = static_cast<u64>(sample[6] * 0xffffffffffffffff) | 0x7fffffffffffffff;
-            chunks[7] = static_cast<u64>(sample[7] * 0xffffffffffffffff) | 0x7fffffffffffffff;
+            // Generate random values (eight chunks per pair of RNG taps)
+            // Lower chunks in each metachunk are sparse, upper chunks are almost full
+            for (u32 j = 0; j < vol::metachunk::res; j++)
+            {
+                if ((j % 8) == 0)
+                {
+                    parallel::rand_streams[tile_ndx].next(sample);
+                    parallel::rand_streams[tile_ndx].next(sample + 4);
+                }
+                const u64 noise = static_cast<u64>(sample[j % 8] * 0xffffffffffffffff);
+                chunks[j] = (j < (vol::metachunk::res / 2)) ? (noise & 0x7fffffffffffffff) :
+                                                              (noise | 0x7fffffffffffffff);
+            }
 #endif
 #else
             const vmath::vec<3> uvw = vol::expand_ndx<vol::num_metachunks_x, vol::num_metachunks_xy>(i);
             const float d = (uvw - circOrigin).sqr_magnitude() - r2; // Sphere SDF
+#ifdef TEST_CAVITY_SPHERE
+            constexpr float cavity_spacing = r * 0.4f;
+            const vmath::vec<3> cell = (uvw / cavity_spacing) - vmath::vfloor(uvw / cavity_spacing) - vmath::vec<3>(0.5f);
+            const bool carved = cell.sqr_magnitude() < (0.42f * 0.42f); // Cavities span 84% of each lattice cell, so they never merge
+            const u64 v = (d < 0.0f && !carved) ? ~0ull : 0x0;
+#else
             u8 v = d < 0.0f ? 0xff : 0x0;
+#endif
             //vol::metachunks[i].batch_assign(v);
-            for (u32 j = 0; j < 8; j++)
+            for (u32 j = 0; j < vol::metachunk::res; j++)
             {
                 vol::metachunks[i].chunks[j] = v;
             }
 #endif
             // Populate metachunk occupancy data
-            u8 occupancies = (vol::metachunks[i].chunks[0] > 0) |
-                             ((vol::metachunks[i].chunks[1] > 0) << 1) |
-                             ((vol::metachunks[i].chunks[2] > 0) << 2) |
-                             ((vol::metachunks[i].chunks[3] > 0) << 3) |
-                             ((vol::metachunks[i].chunks[4] > 0) << 4) |
-                             ((vol::metachunks[i].chunks[5] > 0) << 5) |
-                             ((vol::metachunks[i].chunks[6] > 0) << 6) |
-                             ((vol::metachunks[i].chunks[7] > 0) << 7);
+            vol::metachunk::occupancy_mask occupancies = 0;
+            for (u32 j = 0; j < vol::metachunk::res; j++)
+            {
+                occupancies |= static_cast<vol::metachunk::occupancy_mask>(vol::metachunks[i].chunks[j] > 0) << j;
+            }
             vol::metachunk_occupancies[i] = occupancies;
         };
     }
 
+    // Chunk crossing masks
+    // The voxels a ray can cross inside one chunk depend only on the voxel it enters through and its direction, so we precompute
+    // (conservative) masks of reachable voxels for every entry voxel & quantized direction; chunks that don't overlap their mask
+    // can't be hit, and skip voxel traversal entirely
+    // Directions are binned by major axis & sign, then by the slopes of both minor axes against the major one (in [-1, 1], since the
+    // major axis dominates)
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define CHUNK_CROSSING_MASKS
+    constexpr u32 crossing_slope_bins = 4; // Per minor axis; footprint grows with the square of this
+    constexpr u32 num_crossing_dir_bins = 6 * crossing_slope_bins * crossing_slope_bins;
+    export constexpr u32 chunk_crossing_table_footprint = num_crossing_dir_bins * 64 * sizeof(u64);
+    u64 chunk_crossing_masks[num_crossing_dir_bins][64];
+
+    // Optional traversal counters for [bench::time_crossing_masks]; only meaningful single-threaded, so they stay compiled out of
+    // regular builds
+//#define TRAVERSAL_STATS
+#ifdef TRAVERSAL_STATS
+    export constexpr bool traversal_stats_enabled = true;
+#else
+    export constexpr bool traversal_stats_enabled = false;
+#endif
+    export struct traversal_stats
+    {
+        u64 voxel_steps = 0; // Voxel-level loop iterations in [brick_step]
+        u64 chunks_entered = 0; // Occupied chunks reaching voxel traversal
+        u64 chunks_skipped = 0; // Occupied chunks skipped by crossing masks
+        bool use_crossing_masks = true; // Lets the benchmark measure steps with & without masks in one build
+    };
+    export traversal_stats dda_stats;
+
+    // Minor axes for each major axis, in increasing order
+    constexpr u8 crossing_minor_axes[3][2] = { { 1, 2 }, { 0, 2 }, { 0, 1 } };
+
+    // Direction bin for a voxel-space direction with major axis [major]
+    u32 crossing_dir_bin(const float* d, u8 major)
+    {
+        const float inv_major = 1.0f / vmath::max(vmath::fabs(d[major]), 0.00000001f);
+        u32 bin = (major * 2) + (d[major] < 0.0f ? 1 : 0);
+        for (u8 i = 0; i < 2; i++)
+        {
+            const float slope = d[crossing_minor_axes[major][i]] * inv_major;
+            const u32 slope_bin = static_cast<u32>(vmath::clamp((slope + 1.0f) * 0.5f * crossing_slope_bins, 0.0f, crossing_slope_bins - 1.0f));
+            bin = (bin * crossing_slope_bins) + slope_bin;
+        }
+        return bin;
+    }
+
+    // Voxel [v] is reachable from anywhere in voxel [e] when, over the span of major-axis distances [tau] putting the ray inside [v]'s
+    // major-axis slab, the range of minor-axis offsets covered by every slope in the bin overlaps [v] on both minor axes
+    // (treating the two minor axes independently is what makes the masks conservative rather than exact)
+    void build_chunk_crossing_masks()
+    {
+        constexpr u32 chunk_res[3] = { vol::metachunk::chunk_res_x, vol::metachunk::chunk_res_y, vol::metachunk::chunk_res_z };
+        auto voxel_coords = [&](u32 bit, float* out)
+        {
+            out[0] = static_cast<float>(bit % chunk_res[0]);
+            out[1] = static_cast<float>((bit / chunk_res[0]) % chunk_res[1]);
+            out[2] = static_cast<float>(bit / (chunk_res[0] * chunk_res[1]));
+        };
+        for (u32 bin = 0; bin < num_crossing_dir_bins; bin++)
+        {
+            const u32 major_bin = bin / (crossing_slope_bins * crossing_slope_bins);
+            const u8 major = static_cast<u8>(major_bin >> 1);
+            const bool negative = major_bin & 1;
+            const u32 slope_bins[2] = { (bin / crossing_slope_bins) % crossing_slope_bins, bin % crossing_slope_bins };
+            for (u32 e = 0; e < 64; e++)
+            {
+                float ev[3];
+                voxel_coords(e, ev);
+                u64 mask = 0;
+                for (u32 v = 0; v < 64; v++)
+                {
+                    float vv[3];
+                    voxel_coords(v, vv);
+
+                    // Major-axis distances overlapping [v]'s slab (voxels are unit cubes)
+                    const float tau_min = vmath::max(negative ? (ev[major] - (vv[major] + 1.0f)) : (vv[major] - (ev[major] + 1.0f)), 0.0f);
+                    const float tau_max = negative ? ((ev[major] + 1.0f) - vv[major]) : ((vv[major] + 1.0f) - ev[major]);
+                    bool reachable = tau_max >= tau_min;
+                    for (u8 i = 0; i < 2 && reachable; i++)
+                    {
+                        const u8 minor = crossing_minor_axes[major][i];
+                        const float slope_lo = -1.0f + (2.0f * slope_bins[i]) / crossing_slope_bins;
+                        const float slope_hi = -1.0f + (2.0f * (slope_bins[i] + 1)) / crossing_slope_bins;
+                        const float lo = ev[minor] + vmath::min(slope_lo * tau_min, slope_lo * tau_max);
+                        const float hi = (ev[minor] + 1.0f) + vmath::max(slope_hi * tau_min, slope_hi * tau_max);
+                        reachable = (lo <= (vv[minor] + 1.0f)) && (hi >= vv[minor]);
+                    }
+                    mask |= static_cast<u64>(reachable) << v;
+                }
+                chunk_crossing_masks[bin][e] = mask;
+            }
+        }
+    }
+
     export void init(vmath::vec<2>(*inverse_lens_sampler_fn)(vmath::vec<3>))
     {
         // Allocate volume memory
         vol::metadata = mem::allocate_tracing<vol::vol_nfo>(sizeof(vol::vol_nfo)); // Generalized volume info
         vol::metachunks = mem::allocate_tracing<vol::metachunk>(vol::num_metachunks * sizeof(vol::metachunk)); // Generalized volume info
-        vol::metachunk_occupancies = mem::allocate_tracing<u8>(vol::num_metachunks * sizeof(u8));
+        vol::metachunk_occupancies = mem::allocate_tracing<vol::metachunk::occupancy_mask>(vol::num_metachunks * sizeof(vol::metachunk::occupancy_mask) +
+                                                                                           sizeof(u32)); // Padded so 32-bit gathers on the final metachunk stay in bounds
+        vol::solid_metachunks = mem::allocate_tracing<u64>(vol::num_solid_metachunk_words * sizeof(u64));
+        vol::occupied_coarse_bricks = mem::allocate_tracing<u16>(vol::num_coarse_bricks * sizeof(u16));
+        vol::view_version = mem::allocate_tracing<platform::threads::osAtomicInt>(sizeof(platform::threads::osAtomicInt));
+        vol::volume_version = mem::allocate_tracing<platform::threads::osAtomicInt>(sizeof(platform::threads::osAtomicInt));
+        vol::view_version->init();
+        vol::volume_version->init();
+        vol::volume_version->inc(); // New voxel data; anything traced against the previous volume is stale
+        build_chunk_crossing_masks();
 
         // Load/generate geometry
 //#define TIMED_GEOMETRY_UPLOAD
@@ -384,6 +640,38 @@ namespace geometry
             loaded = loadTest;
             if (loaded) break;
         }
+
+        // Flag fully-solid metachunks for occlusion queries, and list occupied coarse bricks for screen-space prepasses
+        // Resolved serially after loading, since neighbouring metachunks share mask words
+        platform::osClearMem(vol::solid_metachunks, vol::num_solid_metachunk_words * sizeof(u64));
+        u64 coarse_occupancies[(vol::num_coarse_bricks + 63) / 64] = {};
+        for (u32 i = 0; i < vol::num_metachunks; i++)
+        {
+            bool solid = (vol::metachunk_occupancies[i] == vol::metachunk::occupancy_bits);
+            for (u32 j = 0; j < vol::metachunk::res && solid; j++)
+            {
+                solid = (vol::metachunks[i].chunks[j] == ~0ull);
+            }
+            vol::solid_metachunks[i >> 6] |= static_cast<u64>(solid) << (i & 63);
+            if (vol::metachunk_occupancies[i] != 0)
+            {
+                const u32 mc_x = i % vol::num_metachunks_x;
+                const u32 mc_y = (i % vol::num_metachunks_xy) / vol::num_metachunks_x;
+                const u32 mc_z = i / vol::num_metachunks_xy;
+                const u32 brick_ndx = ((mc_x * vol::metachunk::num_vox_x) / vol::coarse_brick_width) +
+                                      ((mc_y * vol::metachunk::num_vox_y) / vol::coarse_brick_width) * vol::num_coarse_bricks_per_axis +
+                                      ((mc_z * vol::metachunk::num_vox_z) / vol::coarse_brick_width) * vol::num_coarse_bricks_per_axis * vol::num_coarse_bricks_per_axis;
+                coarse_occupancies[brick_ndx >> 6] |= 1ull << (brick_ndx & 63);
+            }
+        }
+        vol::num_occupied_coarse_bricks = 0;
+        for (u32 i = 0; i < vol::num_coarse_bricks; i++)
+        {
+            if ((coarse_occupancies[i >> 6] >> (i & 63)) & 1)
+            {
+                vol::occupied_coarse_bricks[vol::num_occupied_coarse_bricks++] = static_cast<u16>(i);
+            }
+        }
 #ifdef TIMED_GEOMETRY_UPLOAD
         platform::osDebugLogFmt("geometry loaded within %f seconds \n", platform::osGetCurrentTimeSeconds() - geom_setup_t);
         platform::osDebugBreak();
@@ -397,6 +685,7 @@ namespace geometry
         vol::metadata->transf.orientation = vmath::vec<4>(0.0f, 0.0f, 0.0f, 1.0f);
         vol::metadata->transf.scale = vmath::vec<3>(4, 4, 4);
         vol::resolveSSBounds(inverse_lens_sampler_fn);
+        vol::resolve_view();
 
         // Update material metadata; eventually this should be loaded from disk
         materials::instance& boxMat = vol::metadata->mat;
@@ -412,6 +701,7 @@ namespace geometry
         vmath::vec<4> q_xrot(axes.x(), 0.0f, 0.0f, vmath::fcos(xrot));
         vmath::vec<4> q_yrot(0.0f, axes.y(), 0.0f, vmath::fcos(yrot));
         vol::metadata->transf.orientation = q_xrot.qtn_rotation_concat(q_yrot).qtn_rotation_concat(vol::metadata->transf.orientation);
+        vol::resolve_view();
     }
 
     export void zoom(float z)
@@ -419,33 +709,28 @@ namespace geometry
         z = vmath::max(z + 1.0f, 0.0f); // Keep z above 0.0f
                                          // (+ above 1.0f by default)
         vol::metadata->transf.scale *= z;
+        vol::resolve_view();
     }
 
     // Test the bounding geometry for the volume grid
     // Used to quickly mask out rays that immediately hit the sky or an external light source
     export bool test(vmath::vec<3> dir, vmath::vec<3>* ro_inout, geometry::vol::vol_nfo* vol_nfo_out)
     {
-        // Compute transformed ray position & direction
-        vmath::vec<3> pos = vol::metadata->transf.pos;
-        vmath::vec<3> ro = *ro_inout - pos;
-        vmath::vec<3> rd = dir.qtn_rotation_apply(vol::metadata->transf.orientation);
-
         // Intersection vmath adapted from
         // https://www.shadertoy.com/view/ltKyzm, itself adapted from the Scratchapixel tutorial here:
         // https://www.scratchapixel.com/lessons/3d-basic-rendering/minimal-ray-tracer-rendering-simple-shapes/ray-box-intersection
 
-        // Synthesize box boundaries
-        const vmath::vec<3> extents = vol::metadata->transf.scale * 0.5f; // Extents from object origin
-        const vmath::vec<3> boundsMin = (pos - extents);
-        const vmath::vec<3> boundsMax = (pos + extents);
+        // Box boundaries are resolved once per-view (see [vol::resolve_view])
+        const vmath::vec<3> boundsMin = vol::view.bounds_min;
+        const vmath::vec<3> boundsMax = vol::view.bounds_max;
 
         // Evaluate per-axis distances to each plane in the box
-        // Not super sure why these divisions happen?
-        // Should probably reread vmath for all this in general
+        // (slab distances, measured from the ray origin; the camera isn't at the world origin, so dividing bounds alone placed grid
+        // entries off each ray)
         vmath::vec<3> plane_dists[2] =
         {
-            boundsMin / dir,
-            boundsMax / dir
+            (boundsMin - *ro_inout) / dir,
+            (boundsMax - *ro_inout) / dir
         };
 
         // Keep near distances in [0], far distances in [1]
@@ -541,8 +826,8 @@ namespace geometry
             u8 min_axis = 0; // Smallest axis in our traversal vector, used to determine which direction to step through in each tap
             u32 metachunk_ndx = init_metachunk_ndx; // Saved on metachunk intersection to simplify chunk lookups
             u32 chunk_ndx = init_ndces.chunk; // Saved on chunk intersection to simplify voxel lookups
-            u8 current_metachunk = 1;
-            u8 current_chunk_mask = 1;
+            vol::metachunk::occupancy_mask current_metachunk = 1;
+            vol::metachunk::occupancy_mask current_chunk_mask = 1;
             bool cell_found = false;
             enum TRAVERSAL_MODE
             {
@@ -559,9 +844,8 @@ namespace geometry
                            /* d_pos.x() < d_pos.y() || d_pos.x() <= d_pos.z() */ 2 /* : 0*/;
 
                 // Scale our step sizes differently for different traversal granularities
-                const u32 dda_res = mode == METACHUNK ? vol::metachunk::num_vox_x :
-                                    mode == CHUNK ? vol::metachunk::chunk_res_x :
-                                            /*VOXEL ? */1;
+                // (brick shapes can be non-cubic, so step sizes vary per-axis as well as per-level)
+                const u32 dda_res = vol::dda_scales[mode][min_axis];
 
                 // We want to weight each continuous step by its axis' contribution to the slope of the ray direction
                 t.e[min_axis] += g.e[min_axis] * dda_res; // Optional scale here for metachunk traversal
@@ -585,7 +869,7 @@ namespace geometry
                 if (mode == METACHUNK)
                 {
                     metachunk_ndx = local_metachunk_ndx;
-                    u8 metachunk_data = vol::metachunk_occupancies[metachunk_ndx];
+                    vol::metachunk::occupancy_mask metachunk_data = vol::metachunk_occupancies[metachunk_ndx];
                     if (metachunk_data)
                     {
                         current_metachunk = metachunk_data;
@@ -595,7 +879,7 @@ namespace geometry
                 else if (mode == CHUNK)
                 {
                     chunk_ndx = vol::chunk_index_solver(uvw_floored);
-                    current_chunk_mask = 1 << chunk_ndx;
+                    current_chunk_mask = static_cast<vol::metachunk::occupancy_mask>(1ull << chunk_ndx);
 
                     if (metachunk_ndx != local_metachunk_ndx)
                     {
@@ -663,14 +947,12 @@ namespace geometry
             //uvw_scaled = uvw * geometry::vol::width; // Voxel coordinates! :D
 
             // Reversed math
+            // (folded into one scale/offset per-view, see [vol::resolve_view])
             vmath::vec<3> ro = vmath::vec<3>(uvw_floored.x(), uvw_floored.y(), uvw_floored.z());// + (dir * t.magnitude()); // Apply position delta
-            ro /= vol::width; // Back to UVW space (0...1)
-            ro *= vol::metadata->transf.scale; // Back to object space
-            ro -= vol::metadata->transf.scale * 0.5f; // Position relative to centre, not lower corner
-            ro += vol::metadata->transf.pos; // Back to worldspace :D
+            ro = (ro * vol::view.voxel_to_world_scale) + vol::view.voxel_to_world_offs; // Back to worldspace :D
             ro = vmath::clamp(ro,
-                              vmath::vec<3>(vol::metadata->transf.pos - vol::metadata->transf.scale * 0.5f),
-                              vmath::vec<3>(vol::metadata->transf.pos + vol::metadata->transf.scale * 0.5f));
+                              vol::view.bounds_min,
+                              vol::view.bounds_max);
             *ro_inout = ro;
 
             // Return cell discovery state
@@ -684,6 +966,1146 @@ namespace geometry
             return true;
         }
     }
+
+    // Exact traversal
+    // Unlike [cell_step], these paths walk every metachunk/chunk/voxel boundary the ray actually crosses (Amanatides & Woo,
+    // "A Fast Voxel Traversal Algorithm for Ray Tracing"), so they never step diagonally past occupied cells
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Per-ray traversal state; origins and directions are in voxel space, but directions are scaled by [width / scale] so that
+    // parametric distances along each ray stay in worldspace units
+    // Everything the DDA loops need per-step is precomputed here, so stepping reduces to a table lookup, an add, and a compare
+    export struct dda_ray
+    {
+        float o[3];
+        float d[3];
+        float inv_d[3];
+        i32 step[3];
+        float t_delta[3][3]; // Parametric distance between cell boundaries at each traversal level (metachunk, chunk, voxel), per-axis
+        i32 ndx_step[3][3]; // Signed index offsets for one step along each axis; metachunk indices, chunk indices within metachunks, and voxel bits within chunks
+        u8 entry_axis; // Axis crossed when the ray entered the grid, used for normals on rays that hit their starting voxel
+        u8 major_axis; // Axis with the shortest voxel-level [t_delta]; voxel runs (see [voxel_run]) follow it
+        u16 crossing_bin; // Direction bin for [chunk_crossing_masks]
+        u8 octant; // Direction signs packed as bits (bit [i] set when [step[i]] is negative); selects the kernels in [metachunk_dda_finish_kernels]
+    };
+
+    // Traversal output for exact traversal paths
+    export struct traversal_hit
+    {
+        vmath::vec<3, i32> voxel; // Intersected voxel coordinate
+        float t = 0.0f; // Worldspace distance from the ray origin to the intersected voxel
+        u8 axis = 2; // Axis crossed on entry to the intersected voxel
+        bool hit = false;
+    };
+
+    // Parametric segment for bounded queries; cells entered before [t_min] or after [t_max] are ignored (distances are in worldspace
+    // units, same as [traversal_hit::t])
+    // Traversal starts from the cell containing the point at [t_min], so that cell counts as entered at [t_min]
+    export constexpr float dda_unbounded = 1e30f;
+    export struct dda_segment
+    {
+        float t_min = 0.0f;
+        float t_max = dda_unbounded;
+    };
+
+    // Smallest direction component we divide through; rays parallel to an axis get huge (but finite) boundary distances on that axis
+    constexpr float dda_min_dir = 0.00000001f;
+
+    // Metachunk counts per-axis, in the same order as [vol::dda_scales]
+    constexpr i32 num_metachunks_per_axis[3] = { vol::num_metachunks_x, vol::num_metachunks_y, vol::num_metachunks_z };
+
+    // Cell counts within each parent cell, per-level & per-axis (metachunks per grid, chunks per metachunk, voxels per chunk)
+    constexpr u32 dda_cells_per_parent[3][3] = { { vol::num_metachunks_x, vol::num_metachunks_y, vol::num_metachunks_z },
+                                                 { vol::metachunk::res_x, vol::metachunk::res_y, vol::metachunk::res_z },
+                                                 { vol::metachunk::chunk_res_x, vol::metachunk::chunk_res_y, vol::metachunk::chunk_res_z } };
+
+    // Index strides for each level, matching [dda_cells_per_parent]
+    constexpr i32 dda_ndx_strides[3][3] = { { 1, vol::num_metachunks_x, vol::num_metachunks_xy },
+                                            { 1, vol::metachunk::res_x, vol::metachunk::res_xy },
+                                            { 1, vol::metachunk::chunk_res_x, vol::metachunk::chunk_res_xy } };
+
+    // Branch-free axis selection (after Amanatides & Woo); indexed by ((t_max[0] < t_max[1]) << 2) | ((t_max[0] < t_max[2]) << 1) | (t_max[1] < t_max[2])
+    // Matches the nested ternaries we used before, so ties still resolve towards z, then y
+    constexpr u8 dda_axis_lut[8] = { 2, 1, 2, 1, 2, 2, 0, 0 };
+    template<typename t_type>
+    u8 dda_min_axis(const t_type* t_max)
+    {
+        return dda_axis_lut[(static_cast<u32>(t_max[0] < t_max[1]) << 2) |
+                            (static_cast<u32>(t_max[0] < t_max[2]) << 1) |
+                             static_cast<u32>(t_max[1] < t_max[2])];
+    }
+
+    // Traversal kernels below are templated on the ray octant, so step signs and index offsets fold into constants instead of being
+    // loaded from [dda_ray] every step; [dda_any_octant] reads them from the ray at runtime (used by the generic/reference paths)
+    constexpr u8 dda_any_octant = 8;
+    template<u8 octant>
+    i32 dda_step(const dda_ray& r, u8 axis)
+    {
+        if constexpr (octant == dda_any_octant) return r.step[axis];
+        else return ((octant >> axis) & 1) ? -1 : 1;
+    }
+
+    template<u8 octant>
+    i32 dda_ndx_step(const dda_ray& r, u8 lvl, u8 axis)
+    {
+        if constexpr (octant == dda_any_octant) return r.ndx_step[lvl][axis];
+        else return dda_step<octant>(r, axis) * dda_ndx_strides[lvl][axis];
+    }
+
+    // Map a worldspace ray (already moved onto/inside the grid by [test(...)]) into voxel space
+    export dda_ray make_dda_ray(vmath::vec<3> ori, vmath::vec<3> dir)
+    {
+        const vol::view_transform& view = vol::view;
+        const vmath::vec<3> uvw_scaled = (ori * view.world_to_voxel_scale) + view.world_to_voxel_offs;
+        const vmath::vec<3> dir_scaled = dir * view.world_to_voxel_scale;
+        constexpr float max_coord = vol::width - 0.001f; // Keep origins strictly inside the grid (same idea as the clamp in [scene::isect])
+        dda_ray r;
+        r.entry_axis = 2;
+        float min_face_dist = 9999.9f;
+        for (u8 i = 0; i < 3; i++)
+        {
+            r.o[i] = vmath::clamp(uvw_scaled.e[i], 0.0f, max_coord);
+            r.d[i] = dir_scaled.e[i];
+            r.step[i] = dir_scaled.e[i] >= 0.0f ? 1 : -1;
+            r.inv_d[i] = 1.0f / (vmath::fabs(dir_scaled.e[i]) < dda_min_dir ? dda_min_dir * r.step[i] : dir_scaled.e[i]);
+            for (u8 lvl = 0; lvl < 3; lvl++)
+            {
+                r.t_delta[lvl][i] = vol::dda_scales[lvl][i] * vmath::fabs(r.inv_d[i]);
+                r.ndx_step[lvl][i] = dda_ndx_strides[lvl][i] * r.step[i];
+            }
+
+            // Rays enter through the face nearest their origin, on the side they're travelling away from
+            const float face_dist = r.step[i] > 0 ? r.o[i] : (vol::width - r.o[i]);
+            if (face_dist < min_face_dist)
+            {
+                min_face_dist = face_dist;
+                r.entry_axis = i;
+            }
+        }
+        r.major_axis = (r.t_delta[2][0] <= r.t_delta[2][1]) ? ((r.t_delta[2][0] <= r.t_delta[2][2]) ? 0 : 2) :
+                                                             ((r.t_delta[2][1] <= r.t_delta[2][2]) ? 1 : 2);
+        r.crossing_bin = static_cast<u16>(crossing_dir_bin(r.d, r.major_axis));
+        r.octant = static_cast<u8>((r.step[0] < 0 ? 1 : 0) | (r.step[1] < 0 ? 2 : 0) | (r.step[2] < 0 ? 4 : 0));
+        return r;
+    }
+
+    // Set up DDA state for one level of the hierarchy, entered at [t] inside the parent cell with lower corner [parent_min]
+    // Entry points are clamped into the parent cell to absorb rounding error from the level above
+    // Returns the flattened cell index within the parent
+    template<u8 octant = dda_any_octant>
+    u32 dda_level_init(const dda_ray& r, u8 lvl, const i32* parent_min, float t, i32* cell_out, float* t_max_out)
+    {
+        u32 ndx = 0;
+        for (u8 i = 0; i < 3; i++)
+        {
+            const u32 shift = vol::dda_shifts[lvl][i];
+            const i32 parent_width = static_cast<i32>(dda_cells_per_parent[lvl][i] << shift);
+            const float p = vmath::clamp(r.o[i] + (r.d[i] * t), static_cast<float>(parent_min[i]), static_cast<float>(parent_min[i] + parent_width) - 0.001f);
+            cell_out[i] = (static_cast<i32>(p) - parent_min[i]) >> shift;
+            const i32 boundary = parent_min[i] + ((cell_out[i] + (dda_step<octant>(r, i) > 0 ? 1 : 0)) << shift);
+            t_max_out[i] = (boundary - r.o[i]) * r.inv_d[i];
+            ndx += static_cast<u32>(cell_out[i] * dda_ndx_strides[lvl][i]);
+        }
+        return ndx;
+    }
+
+    // Voxel runs
+    // Chunks are single u64s, so instead of testing one bit per voxel step we can gather every voxel the DDA would visit along one
+    // axis (until it switches axes, or leaves the chunk) into a mask, and find the first filled voxel in that run with one bit-scan
+    // [tzcnt] finds the nearest filled voxel for runs stepping up through bit indices, [lzcnt] for runs stepping down
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define VOXEL_RUN_BITSCAN
+    constexpr u32 max_voxel_run_xy = vol::metachunk::chunk_res_x > vol::metachunk::chunk_res_y ? vol::metachunk::chunk_res_x : vol::metachunk::chunk_res_y;
+    constexpr u32 max_voxel_run = max_voxel_run_xy > vol::metachunk::chunk_res_z ? max_voxel_run_xy : vol::metachunk::chunk_res_z;
+    struct voxel_run_mask_table
+    {
+        u64 m[3][64][max_voxel_run]; // Axis, lowest bit in the run, number of steps after the first voxel
+    };
+    constexpr voxel_run_mask_table build_voxel_run_masks()
+    {
+        voxel_run_mask_table table = {};
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+            const u32 stride = static_cast<u32>(dda_ndx_strides[2][axis]);
+            for (u32 first = 0; first < 64; first++)
+            {
+                u64 mask = 0;
+                for (u32 len = 0; len < max_voxel_run; len++)
+                {
+                    const u32 bit = first + len * stride;
+                    mask |= (bit < 64) ? (1ull << bit) : 0ull;
+                    table.m[axis][first][len] = mask;
+                }
+            }
+        }
+        return table;
+    }
+    constexpr voxel_run_mask_table voxel_run_masks = build_voxel_run_masks();
+
+    // Mask for the run starting at the current voxel (entered at [t_vox], bit [bit]) along [axis]; steps along [axis] continue while
+    // [dda_min_axis] would keep picking it, so runs match per-step traversal exactly
+    // Outputs the number of steps in the run, the entry distance of its last voxel, and the next [axis] boundary after the run
+    template<u8 octant = dda_any_octant>
+    u64 voxel_run(const dda_ray& r, const i32* v, const float* v_t_max, u8 axis, u32 bit, float t_vox, u32* len_out, float* t_last_out, float* t_max_out)
+    {
+        float lim_lt = dda_unbounded; // Later axes win ties (same as [dda_axis_lut]), so we need to stay strictly below them...
+        float lim_le = dda_unbounded; // ...but only level with earlier axes
+        for (u8 i = 0; i < 3; i++)
+        {
+            if (i > axis) lim_lt = vmath::min(lim_lt, v_t_max[i]);
+            else if (i < axis) lim_le = vmath::min(lim_le, v_t_max[i]);
+        }
+        const u32 remaining = dda_step<octant>(r, axis) > 0 ? (dda_cells_per_parent[2][axis] - 1 - v[axis]) : v[axis];
+        float t_axis = v_t_max[axis];
+        float t_last = t_vox;
+        u32 len = 0;
+        while (len < remaining && t_axis < lim_lt && t_axis <= lim_le)
+        {
+            t_last = t_axis;
+            t_axis += r.t_delta[2][axis];
+            len++;
+        }
+        *len_out = len;
+        *t_last_out = t_last;
+        *t_max_out = t_axis;
+        const u32 first = dda_step<octant>(r, axis) > 0 ? bit : bit - len * dda_ndx_strides[2][axis];
+        return voxel_run_masks.m[axis][first][len];
+    }
+
+    // Exact chunk/voxel traversal inside one metachunk, entered at [t] through [axis]
+    // With [skip_origin] set, voxels entered at the start of [seg] (i.e. the voxel containing the ray origin, for segments starting at
+    // zero) are ignored; bounce rays use that to avoid re-hitting the surface they're leaving
+    template<u8 octant = dda_any_octant>
+    bool brick_step(const dda_ray& r, const i32* mc, u32 mc_ndx, float t, u8 axis, dda_segment seg, traversal_hit* hit_out, bool skip_origin)
+    {
+        const vol::metachunk::occupancy_mask occupancy = vol::metachunk_occupancies[mc_ndx];
+        const u64* chunks = vol::metachunks[mc_ndx].chunks;
+        const i32 mc_min[3] = { mc[0] << vol::dda_shifts[0][0],
+                                mc[1] << vol::dda_shifts[0][1],
+                                mc[2] << vol::dda_shifts[0][2] };
+
+        // Chunk-level DDA
+        i32 c[3];
+        float c_t_max[3];
+        u32 chunk_ndx = dda_level_init<octant>(r, 1, mc_min, t, c, c_t_max);
+        for (;;)
+        {
+            if (t > seg.t_max) return false;
+            if ((occupancy >> chunk_ndx) & 1)
+            {
+                // Voxel-level DDA, stepping bit indices directly
+                const i32 chunk_min[3] = { mc_min[0] + (c[0] << vol::dda_shifts[1][0]),
+                                           mc_min[1] + (c[1] << vol::dda_shifts[1][1]),
+                                           mc_min[2] + (c[2] << vol::dda_shifts[1][2]) };
+                const u64 chunk = chunks[chunk_ndx];
+                i32 v[3];
+                float v_t_max[3];
+                u32 bit = dda_level_init<octant>(r, 2, chunk_min, t, v, v_t_max);
+#if defined(CHUNK_CROSSING_MASKS) && defined(TRAVERSAL_STATS)
+                const bool chunk_crossed = !dda_stats.use_crossing_masks || (chunk & chunk_crossing_masks[r.crossing_bin][bit]) != 0;
+#elif defined(CHUNK_CROSSING_MASKS)
+                const bool chunk_crossed = (chunk & chunk_crossing_masks[r.crossing_bin][bit]) != 0; // Proves misses for the whole chunk in one test
+#else
+                constexpr bool chunk_crossed = true;
+#endif
+#ifdef TRAVERSAL_STATS
+                dda_stats.chunks_entered++;
+                dda_stats.chunks_skipped += chunk_crossed ? 0 : 1;
+#endif
+                float t_vox = t;
+                u8 axis_vox = axis;
+                while (chunk_crossed)
+                {
+                    if (t_vox > seg.t_max) return false;
+#ifdef TRAVERSAL_STATS
+                    dda_stats.voxel_steps++;
+#endif
+#ifdef VOXEL_RUN_BITSCAN
+                    // Test the current voxel and the rest of its run along the ray's major axis together
+                    const u8 run_axis = r.major_axis;
+                    u32 run_len;
+                    float run_t_last, run_t_max;
+                    u64 run_hits = chunk & voxel_run<octant>(r, v, v_t_max, run_axis, bit, t_vox, &run_len, &run_t_last, &run_t_max);
+                    while (run_hits != 0)
+                    {
+                        const u32 hit_bit = dda_step<octant>(r, run_axis) > 0 ? static_cast<u32>(_tzcnt_u64(run_hits)) : 63 - static_cast<u32>(_lzcnt_u64(run_hits));
+                        const u32 run_ndx = (dda_step<octant>(r, run_axis) > 0 ? hit_bit - bit : bit - hit_bit) / dda_ndx_strides[2][run_axis];
+                        float t_hit = t_vox;
+                        if (run_ndx > 0)
+                        {
+                            // Re-accumulate boundary distances the same way [voxel_run] did, so hit distances match per-step traversal
+                            t_hit = v_t_max[run_axis];
+                            for (u32 j = 1; j < run_ndx; j++) t_hit += r.t_delta[2][run_axis];
+                        }
+                        if (t_hit > seg.t_max) return false;
+                        if (!(skip_origin && t_hit <= seg.t_min))
+                        {
+                            i32 hit_v[3] = { v[0], v[1], v[2] };
+                            hit_v[run_axis] += dda_step<octant>(r, run_axis) * static_cast<i32>(run_ndx);
+                            hit_out->voxel = vmath::vec<3, i32>(chunk_min[0] + hit_v[0], chunk_min[1] + hit_v[1], chunk_min[2] + hit_v[2]);
+                            hit_out->t = t_hit;
+                            hit_out->axis = run_ndx > 0 ? run_axis : axis_vox;
+                            hit_out->hit = true;
+                            return true;
+                        }
+                        run_hits &= ~(1ull << hit_bit);
+                    }
+
+                    // Empty run; jump to its last voxel, then take one regular step off the run axis (or out of the chunk)
+                    if (run_len > 0)
+                    {
+                        v[run_axis] += dda_step<octant>(r, run_axis) * static_cast<i32>(run_len);
+                        bit += dda_ndx_step<octant>(r, 2, run_axis) * static_cast<i32>(run_len);
+                        t_vox = run_t_last;
+                        v_t_max[run_axis] = run_t_max;
+                        axis_vox = run_axis;
+                        if (t_vox > seg.t_max) return false;
+                    }
+#else
+                    if (((chunk >> bit) & 1) && !(skip_origin && t_vox <= seg.t_min))
+                    {
+                        hit_out->voxel = vmath::vec<3, i32>(chunk_min[0] + v[0], chunk_min[1] + v[1], chunk_min[2] + v[2]);
+                        hit_out->t = t_vox;
+                        hit_out->axis = axis_vox;
+                        hit_out->hit = true;
+                        return true;
+                    }
+#endif
+                    axis_vox = dda_min_axis(v_t_max);
+                    t_vox = v_t_max[axis_vox];
+                    v_t_max[axis_vox] += r.t_delta[2][axis_vox];
+                    v[axis_vox] += dda_step<octant>(r, axis_vox);
+                    bit += dda_ndx_step<octant>(r, 2, axis_vox);
+                    if (static_cast<u32>(v[axis_vox]) >= dda_cells_per_parent[2][axis_vox]) break; // Negative coordinates wrap around, so one compare covers both sides
+                }
+            }
+            axis = dda_min_axis(c_t_max);
+            t = c_t_max[axis];
+            c_t_max[axis] += r.t_delta[1][axis];
+            c[axis] += dda_step<octant>(r, axis);
+            chunk_ndx += dda_ndx_step<octant>(r, 1, axis);
+            if (static_cast<u32>(c[axis]) >= dda_cells_per_parent[1][axis]) return false;
+        }
+    }
+
+    // Scalar metachunk-level DDA state; packets spill lanes into these when they fall back to single-ray traversal
+    struct metachunk_dda
+    {
+        float t;
+        float t_max[3];
+        i32 mc[3];
+        u32 ndx;
+        u8 axis;
+    };
+
+    // Start metachunk traversal at [t_start] along [r] (normals for cells entered there fall back to [r.entry_axis])
+    metachunk_dda metachunk_dda_init(const dda_ray& r, float t_start = 0.0f)
+    {
+        constexpr i32 grid_min[3] = { 0, 0, 0 };
+        metachunk_dda s;
+        s.t = t_start;
+        s.axis = r.entry_axis;
+        s.ndx = dda_level_init(r, 0, grid_min, t_start, s.mc, s.t_max);
+        return s;
+    }
+
+    template<u8 octant = dda_any_octant>
+    bool metachunk_dda_finish(const dda_ray& r, metachunk_dda s, dda_segment seg, traversal_hit* hit_out, bool skip_origin)
+    {
+        for (;;)
+        {
+            if (s.t > seg.t_max) return false;
+            if (vol::metachunk_occupancies[s.ndx] != 0 &&
+                brick_step<octant>(r, s.mc, s.ndx, s.t, s.axis, seg, hit_out, skip_origin)) return true;
+            s.axis = dda_min_axis(s.t_max);
+            s.t = s.t_max[s.axis];
+            s.t_max[s.axis] += r.t_delta[0][s.axis];
+            s.mc[s.axis] += dda_step<octant>(r, s.axis);
+            s.ndx += dda_ndx_step<octant>(r, 0, s.axis);
+            if (static_cast<u32>(s.mc[s.axis]) >= dda_cells_per_parent[0][s.axis]) return false;
+        }
+    }
+
+    // Fixed-point traversal
+    // Ray distances here are 32.32 fixed-point worldspace units, and every voxel boundary a ray crosses sits at an integer multiple of
+    // its per-axis boundary spacing from the first boundary past its origin; that makes boundary distances at every level exact
+    // integers, so coarse levels can't drift away from the voxels underneath them, and cell entries need integer division rather than
+    // clamped float positions. Results depend only on the ray setup (plain IEEE float math in [make_dda_ray]), so they're identical
+    // across compilers, optimization levels, and thread counts
+    // Closest-hit queries from the ray origin only (same as [dda_isect]); see [FIXED_POINT_DDA] below to route those here
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    constexpr u32 fixed_dda_frac_bits = 32;
+
+    // Distances saturate here (2^20 worldspace units, far outside any grid we trace), so axes the ray barely moves along can't overflow;
+    // the furthest boundary we ever compute is [fixed_dda_far * (vol::width + 1)], comfortably inside 64 bits
+    constexpr u64 fixed_dda_far = 1ull << (fixed_dda_frac_bits + 20);
+    static_assert((fixed_dda_far >> 32) * (vol::width + 1) < (1ull << 31), "fixed-point boundary distances need to fit in 64 bits");
+
+    export struct fixed_dda_ray
+    {
+        u64 t_first[3]; // Distance to the first voxel boundary past the origin, per-axis
+        u64 t_delta[3]; // Distance between voxel boundaries, per-axis
+        i32 origin[3]; // Voxel containing the ray origin
+        i32 step[3];
+        u8 entry_axis;
+        u16 crossing_bin;
+    };
+
+    u64 fixed_dda_dist(double t)
+    {
+        const double fixed = t * static_cast<double>(1ull << fixed_dda_frac_bits);
+        return fixed >= static_cast<double>(fixed_dda_far) ? fixed_dda_far : static_cast<u64>(fixed);
+    }
+
+    float fixed_dda_to_float(u64 t)
+    {
+        return static_cast<float>(static_cast<double>(t) * (1.0 / static_cast<double>(1ull << fixed_dda_frac_bits)));
+    }
+
+    // Origins are already clamped into the grid by [make_dda_ray], so truncating them gives their voxels directly
+    export fixed_dda_ray make_fixed_dda_ray(const dda_ray& r)
+    {
+        fixed_dda_ray f;
+        for (u8 i = 0; i < 3; i++)
+        {
+            f.origin[i] = static_cast<i32>(r.o[i]);
+            f.step[i] = r.step[i];
+            const double spacing = vmath::fabs(r.inv_d[i]);
+            const double first = r.step[i] > 0 ? (static_cast<double>(f.origin[i] + 1) - r.o[i]) : (r.o[i] - static_cast<double>(f.origin[i]));
+            f.t_first[i] = fixed_dda_dist(first * spacing);
+            f.t_delta[i] = vmath::max(fixed_dda_dist(spacing), static_cast<u64>(1));
+        }
+        f.entry_axis = r.entry_axis;
+        f.crossing_bin = r.crossing_bin;
+        return f;
+    }
+
+    // Distance at which the ray leaves voxel [x] along [axis] ([x] must be the origin voxel or ahead of it)
+    u64 fixed_dda_exit(const fixed_dda_ray& f, u8 axis, i32 x)
+    {
+        return f.t_first[axis] + (static_cast<u64>((x - f.origin[axis]) * f.step[axis]) * f.t_delta[axis]);
+    }
+
+    // Distance at which the ray leaves the cell at [lvl] starting at voxel [cell_min] along [axis]
+    u64 fixed_dda_cell_exit(const fixed_dda_ray& f, u8 lvl, u8 axis, i32 cell_min)
+    {
+        return fixed_dda_exit(f, axis, f.step[axis] > 0 ? (cell_min + static_cast<i32>(vol::dda_scales[lvl][axis]) - 1) : cell_min);
+    }
+
+    // Voxel coordinate along [axis] for a ray entering a cell at [t] through [entry_axis]
+    // Boundaries exactly at [t] on axes after [entry_axis] were crossed first (ties resolve towards later axes, same as [dda_axis_lut]);
+    // [entry_axis] values past two mark the cell holding the ray origin, which hasn't crossed anything yet
+    i32 fixed_dda_voxel_at(const fixed_dda_ray& f, u8 axis, u64 t, u8 entry_axis)
+    {
+        const bool crossed_at_t = axis >= entry_axis;
+        u64 n = 0;
+        if (t > f.t_first[axis] || (crossed_at_t && t == f.t_first[axis]))
+        {
+            const u64 dt = t - f.t_first[axis];
+            n = (dt / f.t_delta[axis]) + ((crossed_at_t || (dt % f.t_delta[axis]) != 0) ? 1 : 0);
+        }
+        return f.origin[axis] + (f.step[axis] * static_cast<i32>(n));
+    }
+
+    constexpr u8 fixed_dda_origin_cell = 3;
+    bool fixed_brick_step(const fixed_dda_ray& f, const i32* mc, u32 mc_ndx, u64 t, u8 axis, traversal_hit* hit_out, bool skip_origin)
+    {
+        const vol::metachunk::occupancy_mask occupancy = vol::metachunk_occupancies[mc_ndx];
+        const u64* chunks = vol::metachunks[mc_ndx].chunks;
+        const i32 mc_min[3] = { mc[0] << vol::dda_shifts[0][0],
+                                mc[1] << vol::dda_shifts[0][1],
+                                mc[2] << vol::dda_shifts[0][2] };
+
+        // Chunk-level DDA
+        i32 c[3];
+        u64 c_t_max[3];
+        u32 chunk_ndx = 0;
+        for (u8 i = 0; i < 3; i++)
+        {
+            c[i] = (fixed_dda_voxel_at(f, i, t, axis) - mc_min[i]) >> vol::dda_shifts[1][i];
+            c_t_max[i] = fixed_dda_cell_exit(f, 1, i, mc_min[i] + (c[i] << vol::dda_shifts[1][i]));
+            chunk_ndx += c[i] * dda_ndx_strides[1][i];
+        }
+        for (;;)
+        {
+            if ((occupancy >> chunk_ndx) & 1)
+            {
+                // Voxel-level DDA
+                const i32 chunk_min[3] = { mc_min[0] + (c[0] << vol::dda_shifts[1][0]),
+                                           mc_min[1] + (c[1] << vol::dda_shifts[1][1]),
+                                           mc_min[2] + (c[2] << vol::dda_shifts[1][2]) };
+                const u64 chunk = chunks[chunk_ndx];
+                i32 v[3];
+                u64 v_t_max[3];
+                u32 bit = 0;
+                for (u8 i = 0; i < 3; i++)
+                {
+                    const i32 x = fixed_dda_voxel_at(f, i, t, axis);
+                    v[i] = x - chunk_min[i];
+                    v_t_max[i] = fixed_dda_exit(f, i, x);
+                    bit += v[i] * dda_ndx_strides[2][i];
+                }
+#ifdef CHUNK_CROSSING_MASKS
+                const bool chunk_crossed = (chunk & chunk_crossing_masks[f.crossing_bin][bit]) != 0;
+#else
+                constexpr bool chunk_crossed = true;
+#endif
+                u64 t_vox = t;
+                u8 axis_vox = axis;
+                while (chunk_crossed)
+                {
+                    if (((chunk >> bit) & 1) && !(skip_origin && t_vox == 0))
+                    {
+                        hit_out->voxel = vmath::vec<3, i32>(chunk_min[0] + v[0], chunk_min[1] + v[1], chunk_min[2] + v[2]);
+                        hit_out->t = fixed_dda_to_float(t_vox);
+                        hit_out->axis = axis_vox == fixed_dda_origin_cell ? f.entry_axis : axis_vox;
+                        hit_out->hit = true;
+                        return true;
+                    }
+                    axis_vox = dda_min_axis(v_t_max);
+                    t_vox = v_t_max[axis_vox];
+                    v_t_max[axis_vox] += f.t_delta[axis_vox];
+                    v[axis_vox] += f.step[axis_vox];
+                    bit += f.step[axis_vox] * dda_ndx_strides[2][axis_vox];
+                    if (static_cast<u32>(v[axis_vox]) >= dda_cells_per_parent[2][axis_vox]) break;
+                }
+            }
+            axis = dda_min_axis(c_t_max);
+            t = c_t_max[axis];
+            c_t_max[axis] += f.t_delta[axis] << vol::dda_shifts[1][axis];
+            c[axis] += f.step[axis];
+            chunk_ndx += f.step[axis] * dda_ndx_strides[1][axis];
+            if (static_cast<u32>(c[axis]) >= dda_cells_per_parent[1][axis]) return false;
+        }
+    }
+
+    export bool fixed_dda_isect(const fixed_dda_ray& f, traversal_hit* hit_out, bool skip_origin)
+    {
+        hit_out->hit = false;
+        i32 mc[3];
+        u64 mc_t_max[3];
+        u32 mc_ndx = 0;
+        for (u8 i = 0; i < 3; i++)
+        {
+            mc[i] = f.origin[i] >> vol::dda_shifts[0][i];
+            mc_t_max[i] = fixed_dda_cell_exit(f, 0, i, mc[i] << vol::dda_shifts[0][i]);
+            mc_ndx += mc[i] * dda_ndx_strides[0][i];
+        }
+        u64 t = 0;
+        u8 axis = fixed_dda_origin_cell;
+        for (;;)
+        {
+            if (vol::metachunk_occupancies[mc_ndx] != 0 &&
+                fixed_brick_step(f, mc, mc_ndx, t, axis, hit_out, skip_origin)) return true;
+            axis = dda_min_axis(mc_t_max);
+            t = mc_t_max[axis];
+            mc_t_max[axis] += f.t_delta[axis] << vol::dda_shifts[0][axis];
+            mc[axis] += f.step[axis];
+            mc_ndx += f.step[axis] * dda_ndx_strides[0][axis];
+            if (static_cast<u32>(mc[axis]) >= dda_cells_per_parent[0][axis]) return false;
+        }
+    }
+
+    // Route [dda_isect] through fixed-point traversal
+//#define FIXED_POINT_DDA
+
+    // Single-ray exact traversal, starting from the ray origin
+    // Replaces the per-step mode switches, index solvers, and bounds tests in [cell_step] with precomputed per-ray tables,
+    // incrementally-updated indices, and table-driven axis selection
+    export bool dda_isect(const dda_ray& r, traversal_hit* hit_out, bool skip_origin)
+    {
+#ifdef FIXED_POINT_DDA
+        return fixed_dda_isect(make_fixed_dda_ray(r), hit_out, skip_origin);
+#else
+        hit_out->hit = false;
+        return metachunk_dda_finish(r, metachunk_dda_init(r), dda_segment(), hit_out, skip_origin);
+#endif
+    }
+
+    // Generic & octant-specialized variants of [dda_isect], compared in [bench::time_octant_kernels]
+    // Specialized kernels run every step with constant signs, but traversal is bound by metachunk/chunk loads rather than sign handling;
+    // per-octant timings stay within run-to-run noise of the generic kernel, so regular traversal never dispatches through these
+    using metachunk_dda_finish_kernel = bool (*)(const dda_ray&, metachunk_dda, dda_segment, traversal_hit*, bool);
+    constexpr metachunk_dda_finish_kernel metachunk_dda_finish_kernels[8] = { metachunk_dda_finish<0>, metachunk_dda_finish<1>,
+                                                                              metachunk_dda_finish<2>, metachunk_dda_finish<3>,
+                                                                              metachunk_dda_finish<4>, metachunk_dda_finish<5>,
+                                                                              metachunk_dda_finish<6>, metachunk_dda_finish<7> };
+
+    export bool dda_isect_any_octant(const dda_ray& r, traversal_hit* hit_out, bool skip_origin)
+    {
+        hit_out->hit = false;
+        return metachunk_dda_finish(r, metachunk_dda_init(r), dda_segment(), hit_out, skip_origin);
+    }
+
+    export bool dda_isect_octant(const dda_ray& r, traversal_hit* hit_out, bool skip_origin)
+    {
+        hit_out->hit = false;
+        return metachunk_dda_finish_kernels[r.octant](r, metachunk_dda_init(r), dda_segment(), hit_out, skip_origin);
+    }
+
+    // Segments starting beyond the grid can't hit anything (and would otherwise be clamped back onto the boundary)
+    bool dda_segment_valid(const dda_ray& r, dda_segment seg)
+    {
+        if (seg.t_min > seg.t_max) return false;
+        for (u8 i = 0; i < 3; i++)
+        {
+            const float p = r.o[i] + (r.d[i] * seg.t_min);
+            if (p < 0.0f || p >= static_cast<float>(vol::width)) return false;
+        }
+        return true;
+    }
+
+    // Bounded exact traversal; closest hit inside [seg]
+    // The walk ends as soon as it passes [seg.t_max], so short connection rays and local probes only pay for the cells they cross
+    export bool dda_isect_segment(const dda_ray& r, dda_segment seg, traversal_hit* hit_out, bool skip_origin)
+    {
+        hit_out->hit = false;
+        if (!dda_segment_valid(r, seg)) return false;
+        return metachunk_dda_finish(r, metachunk_dda_init(r, seg.t_min), seg, hit_out, skip_origin);
+    }
+
+    // Any-hit traversal
+    // Shadow/connection rays only need to know whether anything blocks them, so these loops skip hit records entirely and return on
+    // the first filled voxel inside their segment
+    // Fully-solid chunks and metachunks count as hits as soon as we enter them (unless we entered at the segment start with [skip_origin]
+    // set, since the ray might leave before reaching a second voxel)
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    bool brick_occluded(const dda_ray& r, const i32* mc, u32 mc_ndx, float t, dda_segment seg, bool skip_origin)
+    {
+        const vol::metachunk::occupancy_mask occupancy = vol::metachunk_occupancies[mc_ndx];
+        const u64* chunks = vol::metachunks[mc_ndx].chunks;
+        const i32 mc_min[3] = { mc[0] << vol::dda_shifts[0][0],
+                                mc[1] << vol::dda_shifts[0][1],
+                                mc[2] << vol::dda_shifts[0][2] };
+
+        // Chunk-level DDA
+        i32 c[3];
+        float c_t_max[3];
+        u32 chunk_ndx = dda_level_init(r, 1, mc_min, t, c, c_t_max);
+        for (;;)
+        {
+            if (t > seg.t_max) return false;
+            if ((occupancy >> chunk_ndx) & 1)
+            {
+                const u64 chunk = chunks[chunk_ndx];
+                if (chunk == ~0ull && !(skip_origin && t <= seg.t_min)) return true;
+
+                // Voxel-level DDA, stepping bit indices directly
+                const i32 chunk_min[3] = { mc_min[0] + (c[0] << vol::dda_shifts[1][0]),
+                                           mc_min[1] + (c[1] << vol::dda_shifts[1][1]),
+                                           mc_min[2] + (c[2] << vol::dda_shifts[1][2]) };
+                i32 v[3];
+                float v_t_max[3];
+                u32 bit = dda_level_init(r, 2, chunk_min, t, v, v_t_max);
+                float t_vox = t;
+                for (;;)
+                {
+                    if (t_vox > seg.t_max) return false;
+                    if (((chunk >> bit) & 1) && !(skip_origin && t_vox <= seg.t_min)) return true;
+                    const u8 axis_vox = dda_min_axis(v_t_max);
+                    t_vox = v_t_max[axis_vox];
+                    v_t_max[axis_vox] += r.t_delta[2][axis_vox];
+                    v[axis_vox] += r.step[axis_vox];
+                    bit += r.ndx_step[2][axis_vox];
+                    if (static_cast<u32>(v[axis_vox]) >= dda_cells_per_parent[2][axis_vox]) break;
+                }
+            }
+            const u8 axis = dda_min_axis(c_t_max);
+            t = c_t_max[axis];
+            c_t_max[axis] += r.t_delta[1][axis];
+            c[axis] += r.step[axis];
+            chunk_ndx += r.ndx_step[1][axis];
+            if (static_cast<u32>(c[axis]) >= dda_cells_per_parent[1][axis]) return false;
+        }
+    }
+
+    // Any-hit occlusion query; true when any filled voxel is entered inside [seg]
+    export bool dda_occluded(const dda_ray& r, dda_segment seg, bool skip_origin)
+    {
+        if (!dda_segment_valid(r, seg)) return false;
+        metachunk_dda s = metachunk_dda_init(r, seg.t_min);
+        for (;;)
+        {
+            if (s.t > seg.t_max) return false;
+            if (vol::metachunk_occupancies[s.ndx] != 0)
+            {
+                if (((vol::solid_metachunks[s.ndx >> 6] >> (s.ndx & 63)) & 1) && !(skip_origin && s.t <= seg.t_min)) return true;
+                if (brick_occluded(r, s.mc, s.ndx, s.t, seg, skip_origin)) return true;
+            }
+            s.axis = dda_min_axis(s.t_max);
+            s.t = s.t_max[s.axis];
+            s.t_max[s.axis] += r.t_delta[0][s.axis];
+            s.mc[s.axis] += r.step[s.axis];
+            s.ndx += r.ndx_step[0][s.axis];
+            if (static_cast<u32>(s.mc[s.axis]) >= dda_cells_per_parent[0][s.axis]) return false;
+        }
+    }
+
+    // Interleaved traversal
+    // Incoherent rays spend most of their time waiting on [metachunk_occupancies]/[metachunks] loads, and each step depends on the one
+    // before it, so a single ray can't overlap those misses with anything. These loops round-robin [interleave] independent rays per
+    // thread instead, one metachunk step at a time, prefetching each ray's next metachunk before switching away; by the time we come
+    // back to a ray its data has (hopefully) arrived
+    // Lanes refill from [rays] as soon as they finish, so every lane stays busy until the input runs out
+    // Results match [dda_isect] ray-for-ray (see [bench::time_interleaving])
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    void prefetch_metachunk(u32 mc_ndx)
+    {
+        _mm_prefetch(reinterpret_cast<const char*>(vol::metachunk_occupancies + mc_ndx), _MM_HINT_T0);
+        const char* mc = reinterpret_cast<const char*>(vol::metachunks + mc_ndx);
+        for (u32 line = 0; line < sizeof(vol::metachunk); line += 64)
+        {
+            _mm_prefetch(mc + line, _MM_HINT_T0);
+        }
+    }
+
+    export template<u32 interleave>
+    void interleaved_isect(const dda_ray* rays, u32 num_rays, traversal_hit* hits_out, bool skip_origin)
+    {
+        static_assert(interleave > 0 && interleave <= 32, "lane masks are 32 bits wide");
+        metachunk_dda lanes[interleave];
+        u32 lane_rays[interleave];
+        u32 next_ray = 0;
+        u32 live = 0;
+
+        // Start the next pending ray in [lane]; false once every ray has been issued
+        auto issue = [&](u32 lane)
+        {
+            if (next_ray == num_rays) return false;
+            const u32 i = next_ray++;
+            hits_out[i].hit = false;
+            lanes[lane] = metachunk_dda_init(rays[i]);
+            lane_rays[lane] = i;
+            prefetch_metachunk(lanes[lane].ndx);
+            return true;
+        };
+        for (u32 lane = 0; lane < interleave; lane++)
+        {
+            if (issue(lane)) live |= 1u << lane;
+        }
+
+        while (live != 0)
+        {
+            for (u32 lane = 0; lane < interleave; lane++)
+            {
+                if (!((live >> lane) & 1)) continue;
+                const u32 i = lane_rays[lane];
+                const dda_ray& r = rays[i];
+                metachunk_dda& s = lanes[lane];
+                bool done = vol::metachunk_occupancies[s.ndx] != 0 &&
+                            brick_step(r, s.mc, s.ndx, s.t, s.axis, dda_segment(), hits_out + i, skip_origin);
+                if (!done)
+                {
+                    s.axis = dda_min_axis(s.t_max);
+                    s.t = s.t_max[s.axis];
+                    s.t_max[s.axis] += r.t_delta[0][s.axis];
+                    s.mc[s.axis] += r.step[s.axis];
+                    s.ndx += r.ndx_step[0][s.axis];
+                    done = static_cast<u32>(s.mc[s.axis]) >= dda_cells_per_parent[0][s.axis];
+                    if (!done) prefetch_metachunk(s.ndx);
+                }
+                if (done && !issue(lane))
+                {
+                    live &= ~(1u << lane);
+                }
+            }
+        }
+    }
+
+    // Primary hit caching
+    // Camera rays landing in the same [aa] subpixel follow nearly the same path through the grid, so we store one traversal result
+    // per-subpixel and let later samples reuse it instead of traversing again
+    // Entries are tagged with the view/volume versions they were traced against; bumping either version makes every entry stale at
+    // once, so camera/volume updates never need to clear the cache
+    // Tracers read [current_version()] before testing rays against the grid and pass it through to [store]; stamping versions at store
+    // time would tag hits traced against an old view with the new view's version
+    // Reused hits resolve silhouettes at subpixel precision (same tradeoff as [tracing::isosurf_distances], one level finer)
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    export struct primary_hit_cache
+    {
+        struct entry
+        {
+            u32 voxel_axis; // Hit voxel (ten bits per-axis, x in the low bits), then the normal axis in the top two bits
+            float t; // Distance to the hit from the grid intersection given by [test(...)]
+            u32 version; // [vol::scene_version()] read before the traced ray's grid test
+        };
+        static constexpr u32 coord_bits = 10;
+        static constexpr u32 coord_mask = (1u << coord_bits) - 1;
+        static constexpr u32 miss_axis = 3; // Normal axis stored for rays that crossed the grid without touching any voxels
+        static_assert(vol::width <= (1u << coord_bits), "cached voxel coordinates are packed into ten bits per-axis");
+        entry* entries = nullptr;
+
+        static u32 current_version()
+        {
+            return vol::scene_version();
+        }
+
+        // Fetch the cached hit for subpixel [ndx]; returns false for stale or never-written entries
+        bool lookup(u32 ndx, traversal_hit* hit_out) const
+        {
+            return lookup_version(ndx, current_version(), hit_out);
+        }
+
+        // Fetch the hit cached for subpixel [ndx] under an earlier [version]; lets temporal reprojection read back the previous view's
+        // hits after the current version has moved on
+        bool lookup_version(u32 ndx, u32 version, traversal_hit* hit_out) const
+        {
+            const entry& e = entries[ndx];
+            if (e.version != version) return false;
+            const u32 axis = e.voxel_axis >> (coord_bits * 3);
+            hit_out->hit = (axis != miss_axis);
+            hit_out->axis = hit_out->hit ? static_cast<u8>(axis) : 2;
+            hit_out->voxel = vmath::vec<3, i32>(static_cast<i32>(e.voxel_axis & coord_mask),
+                                                static_cast<i32>((e.voxel_axis >> coord_bits) & coord_mask),
+                                                static_cast<i32>((e.voxel_axis >> (coord_bits * 2)) & coord_mask));
+            hit_out->t = e.t;
+            return true;
+        }
+
+        // Record a freshly-traversed hit (or miss) for subpixel [ndx], traced against the view/volume given by [version]
+        void store(u32 ndx, const traversal_hit& hit, u32 version)
+        {
+            entry& e = entries[ndx];
+            const u32 axis = hit.hit ? hit.axis : miss_axis;
+            e.voxel_axis = (static_cast<u32>(hit.voxel.e[0]) & coord_mask) |
+                           ((static_cast<u32>(hit.voxel.e[1]) & coord_mask) << coord_bits) |
+                           ((static_cast<u32>(hit.voxel.e[2]) & coord_mask) << (coord_bits * 2)) |
+                           (axis << (coord_bits * 3));
+            e.t = hit.t;
+            e.version = version;
+        }
+    };
+
+    // Coarse brick depth spans
+    // A screen-space prepass (see [tracing::brick_depth_prepass]) projects every occupied coarse brick onto the film and keeps the
+    // nearest/farthest worldspace distances from the camera covered by bricks in each pixel; primary traversal then starts at the
+    // nearest distance and ends after the farthest, and pixels with no bricks skip traversal entirely
+    // Spans are versioned the same way as [primary_hit_cache], so stale spans just fall back to full traversal
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    export struct brick_depth_map
+    {
+        struct span
+        {
+            float entry; // Distance from the camera to the nearest brick point projected into the pixel
+            float exit; // Distance from the camera to the farthest brick corner projected into the pixel
+            u32 version; // [vol::scene_version()] at prepass time
+        };
+        static constexpr float span_margin = 0.001f; // Keeps rays grazing brick faces inside their segments
+        span* spans = nullptr;
+
+        // Empty the span for pixel [ndx] before accumulating bricks into it
+        void reset(u32 ndx, u32 version)
+        {
+            spans[ndx].entry = dda_unbounded;
+            spans[ndx].exit = 0.0f;
+            spans[ndx].version = version;
+        }
+
+        // Whether any bricks project into pixel [ndx] (regardless of version)
+        bool covered(u32 ndx) const
+        {
+            return spans[ndx].entry <= spans[ndx].exit;
+        }
+
+        // Widen the span for pixel [ndx] to cover a brick between [entry] and [exit]
+        void include(u32 ndx, float entry, float exit)
+        {
+            span& s = spans[ndx];
+            s.entry = vmath::min(s.entry, entry);
+            s.exit = vmath::max(s.exit, exit);
+        }
+
+        // Whether a surface [dist] away from the camera could be visible through pixel [ndx]; only current spans can say no
+        bool contains(u32 ndx, float dist) const
+        {
+            const span& s = spans[ndx];
+            if (s.version != vol::scene_version()) return true;
+            return dist >= (s.entry - span_margin) && dist <= (s.exit + span_margin);
+        }
+
+        // Bound a primary ray through pixel [ndx]; [grid_dist] is the distance from the camera to the ray's grid entry (i.e. the
+        // origin of its [dda_ray])
+        // Returns false when no bricks project into the pixel; stale spans give unbounded segments
+        bool segment(u32 ndx, float grid_dist, dda_segment* seg_out) const
+        {
+            const span& s = spans[ndx];
+            *seg_out = dda_segment();
+            if (s.version != vol::scene_version()) return true;
+            if (s.entry > s.exit) return false;
+            seg_out->t_min = vmath::max(s.entry - grid_dist - span_margin, 0.0f);
+            seg_out->t_max = (s.exit - grid_dist) + span_margin;
+            return true;
+        }
+
+        // Worldspace bounds for coarse brick [brick_ndx], under the given view
+        static void brick_bounds(u16 brick_ndx, const vol::view_transform& view, vmath::vec<3>* min_out, vmath::vec<3>* max_out)
+        {
+            constexpr u32 n = vol::num_coarse_bricks_per_axis;
+            const vmath::vec<3> brick_min(static_cast<float>((brick_ndx % n) * vol::coarse_brick_width),
+                                          static_cast<float>(((brick_ndx / n) % n) * vol::coarse_brick_width),
+                                          static_cast<float>((brick_ndx / (n * n)) * vol::coarse_brick_width));
+            *min_out = (brick_min * view.voxel_to_world_scale) + view.voxel_to_world_offs;
+            *max_out = ((brick_min + vmath::vec<3>(static_cast<float>(vol::coarse_brick_width))) * view.voxel_to_world_scale) + view.voxel_to_world_offs;
+        }
+    };
+
+    // Ray binning
+    // Bounce rays leave surfaces in random directions, so traversing them in queue order touches unrelated metachunks from one ray to
+    // the next; sorting them by direction octant and origin metachunk (Morton order) first lets neighbouring rays share cached
+    // occupancies & chunks
+    // Only [bench::time_binning] sorts rays; sorting costs more than it saves on the volumes we render, so the wavefront extend stage
+    // traverses bounce rays in queue order
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Spread the low ten bits of [v] so that there are two zero bits between each of them (standard 3D Morton "part-1-by-2" step)
+    u32 morton_spread(u32 v)
+    {
+        v &= 0x3ff;
+        v = (v | (v << 16)) & 0x030000ff;
+        v = (v | (v << 8)) & 0x0300f00f;
+        v = (v | (v << 4)) & 0x030c30c3;
+        v = (v | (v << 2)) & 0x09249249;
+        return v;
+    }
+
+    // Bits from each metachunk coordinate, and the number of Morton bits we keep per key (the finest levels are dropped, so each bin
+    // covers a small block of metachunks rather than a single one)
+    constexpr u32 bin_coord_bits = ilog2(vol::num_metachunks_x | vol::num_metachunks_y | vol::num_metachunks_z); // Metachunk counts are powers of two, so this is log2 of the largest one
+    constexpr u32 bin_morton_bits = 13;
+    static_assert((bin_coord_bits * 3) >= bin_morton_bits, "bin keys expect at least [bin_morton_bits] of metachunk coordinates");
+
+    // Sort key for a worldspace ray; direction octant in the top three bits, then the coarse Morton code of the metachunk containing
+    // the ray origin
+    export u16 bin_key(vmath::vec<3> ori, vmath::vec<3> dir)
+    {
+        const dda_ray r = make_dda_ray(ori, dir);
+        const u32 octant = (r.step[0] > 0 ? 1 : 0) | (r.step[1] > 0 ? 2 : 0) | (r.step[2] > 0 ? 4 : 0);
+        const u32 morton = morton_spread(static_cast<u32>(r.o[0]) >> vol::dda_shifts[0][0]) |
+                          (morton_spread(static_cast<u32>(r.o[1]) >> vol::dda_shifts[0][1]) << 1) |
+                          (morton_spread(static_cast<u32>(r.o[2]) >> vol::dda_shifts[0][2]) << 2);
+        return static_cast<u16>((octant << bin_morton_bits) | (morton >> ((bin_coord_bits * 3) - bin_morton_bits)));
+    }
+
+    // Two-pass (8-bit digit) LSD radix sort over [keys]; writes the sorted order of [num_keys] ray indices into [order_out]
+    // [scratch] needs space for [num_keys] indices
+    export void bin_sort(const u16* keys, u16* order_out, u16* scratch, u32 num_keys)
+    {
+        u32 counts[2][256] = {};
+        for (u32 i = 0; i < num_keys; i++)
+        {
+            counts[0][keys[i] & 0xff]++;
+            counts[1][keys[i] >> 8]++;
+        }
+
+        // Prefix sums -> starting offsets for each digit
+        for (u32 pass = 0; pass < 2; pass++)
+        {
+            u32 offs = 0;
+            for (u32 d = 0; d < 256; d++)
+            {
+                const u32 n = counts[pass][d];
+                counts[pass][d] = offs;
+                offs += n;
+            }
+        }
+
+        // Low digit into [scratch], then high digit back into [order_out]
+        for (u32 i = 0; i < num_keys; i++)
+        {
+            scratch[counts[0][keys[i] & 0xff]++] = static_cast<u16>(i);
+        }
+        for (u32 i = 0; i < num_keys; i++)
+        {
+            const u16 ndx = scratch[i];
+            order_out[counts[1][keys[ndx] >> 8]++] = ndx;
+        }
+    }
+
+    // Packet traversal for coherent primary rays
+    // Eight rays step through [metachunk_occupancies] together (AVX2), with masks for lanes that diverge or terminate; lanes entering
+    // occupied metachunks resolve their chunks/voxels individually through [brick_step], then rejoin the packet if they missed
+    // Once too few lanes are left for the packet to pay for itself, remaining lanes finish as single rays
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    export constexpr u32 packet_width = 8;
+    constexpr u32 packet_min_active_lanes = 3;
+
+    // Gather occupancy masks for every live lane; inactive lanes read zero
+    __m256i gather_occupancies(__m256i ndx, __m256i active)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const int* occupancies = reinterpret_cast<const int*>(vol::metachunk_occupancies);
+        constexpr u32 mask_size = sizeof(vol::metachunk::occupancy_mask);
+        if constexpr (mask_size == 8)
+        {
+            // 64-bit masks; we only care whether any bit is set, so OR the low & high halves together
+            const __m256i lo = _mm256_mask_i32gather_epi32(zero, occupancies, ndx, active, 8);
+            const __m256i hi = _mm256_mask_i32gather_epi32(zero, occupancies + 1, ndx, active, 8);
+            return _mm256_or_si256(lo, hi);
+        }
+        else
+        {
+            const __m256i occ = _mm256_mask_i32gather_epi32(zero, occupancies, ndx, active, mask_size);
+            return _mm256_and_si256(occ, _mm256_set1_epi32(static_cast<i32>(vol::metachunk::occupancy_bits)));
+        }
+    }
+
+    // Optional per-lane [segs] bound each lane's walk (e.g. to the depth span from [tracing::brick_depth_prepass]); lanes with empty
+    // segments are retired before traversal
+    export void packet_isect(const dda_ray* rays, u8 lane_mask, traversal_hit* hits_out, const dda_segment* segs = nullptr)
+    {
+        // Transpose rays into SoA lanes; invalid lanes get safe placeholder values and stay masked out
+        alignas(32) float o[3][packet_width];
+        alignas(32) float start[3][packet_width]; // Lane positions at [t_min]
+        alignas(32) float inv_d[3][packet_width];
+        alignas(32) i32 step[3][packet_width];
+        alignas(32) i32 axis_lanes[packet_width];
+        alignas(32) float t_min_lanes[packet_width];
+        alignas(32) float t_end_lanes[packet_width];
+        dda_segment lane_segs[packet_width];
+        for (u32 lane = 0; lane < packet_width; lane++)
+        {
+            lane_segs[lane] = segs != nullptr ? segs[lane] : dda_segment();
+            hits_out[lane].hit = false;
+            if (((lane_mask >> lane) & 1) && segs != nullptr && !dda_segment_valid(rays[lane], lane_segs[lane]))
+            {
+                lane_mask &= ~(1u << lane);
+            }
+            const bool valid = (lane_mask >> lane) & 1;
+            for (u8 i = 0; i < 3; i++)
+            {
+                o[i][lane] = valid ? rays[lane].o[i] : 0.0f;
+                start[i][lane] = valid ? rays[lane].o[i] + (rays[lane].d[i] * lane_segs[lane].t_min) : 0.0f;
+                inv_d[i][lane] = valid ? rays[lane].inv_d[i] : 1.0f;
+                step[i][lane] = valid ? rays[lane].step[i] : 1;
+            }
+            axis_lanes[lane] = valid ? rays[lane].entry_axis : 2;
+            t_min_lanes[lane] = valid ? lane_segs[lane].t_min : 0.0f;
+            t_end_lanes[lane] = valid ? lane_segs[lane].t_max : dda_unbounded;
+        }
+
+        // Initialize metachunk-level DDA for every lane
+        const __m256i zero_i = _mm256_setzero_si256();
+        const __m256i one_i = _mm256_set1_epi32(1);
+        const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+        __m256i mc[3];
+        __m256i step_v[3];
+        __m256 t_max[3];
+        __m256 t_delta[3];
+        for (u8 i = 0; i < 3; i++)
+        {
+            const __m256 size = _mm256_set1_ps(static_cast<float>(vol::dda_scales[0][i]));
+            const __m256 ov = _mm256_load_ps(o[i]);
+            const __m256 inv = _mm256_load_ps(inv_d[i]);
+            step_v[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(step[i]));
+            mc[i] = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_load_ps(start[i]), size));
+            mc[i] = _mm256_min_epi32(_mm256_max_epi32(mc[i], zero_i), _mm256_set1_epi32(num_metachunks_per_axis[i] - 1));
+            const __m256i positive = _mm256_srli_epi32(_mm256_add_epi32(step_v[i], one_i), 1); // 1 for positive steps, 0 for negative steps
+            const __m256 boundary = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(mc[i], positive)), size);
+            t_max[i] = _mm256_mul_ps(_mm256_sub_ps(boundary, ov), inv);
+            t_delta[i] = _mm256_mul_ps(size, _mm256_andnot_ps(sign_bit, inv));
+        }
+        __m256 t = _mm256_load_ps(t_min_lanes);
+        const __m256 t_end = _mm256_load_ps(t_end_lanes);
+        __m256i axis = _mm256_load_si256(reinterpret_cast<const __m256i*>(axis_lanes));
+
+        // Lane state spilled for scalar work
+        alignas(32) float t_lanes[packet_width];
+        alignas(32) float t_max_lanes[3][packet_width];
+        alignas(32) i32 mc_lanes[3][packet_width];
+        alignas(32) i32 ndx_lanes[packet_width];
+        __m256i ndx;
+        auto spill = [&]()
+        {
+            _mm256_store_ps(t_lanes, t);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(ndx_lanes), ndx);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(axis_lanes), axis);
+            for (u8 i = 0; i < 3; i++)
+            {
+                _mm256_store_ps(t_max_lanes[i], t_max[i]);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(mc_lanes[i]), mc[i]);
+            }
+        };
+
+        const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        const __m256i mc_stride_y = _mm256_set1_epi32(vol::num_metachunks_x);
+        const __m256i mc_stride_z = _mm256_set1_epi32(vol::num_metachunks_xy);
+        u32 pending = lane_mask;
+        while (pending != 0)
+        {
+            ndx = _mm256_add_epi32(mc[0], _mm256_add_epi32(_mm256_mullo_epi32(mc[1], mc_stride_y),
+                                                          _mm256_mullo_epi32(mc[2], mc_stride_z)));
+
+            // Fall back to single rays once most lanes have terminated
+            if (_mm_popcnt_u32(pending) < packet_min_active_lanes)
+            {
+                spill();
+                while (pending != 0)
+                {
+                    const u32 lane = _tzcnt_u32(pending);
+                    metachunk_dda s;
+                    s.t = t_lanes[lane];
+                    s.axis = static_cast<u8>(axis_lanes[lane]);
+                    s.ndx = static_cast<u32>(ndx_lanes[lane]);
+                    for (u8 i = 0; i < 3; i++)
+                    {
+                        s.t_max[i] = t_max_lanes[i][lane];
+                        s.mc[i] = mc_lanes[i][lane];
+                    }
+                    metachunk_dda_finish(rays[lane], s, lane_segs[lane], hits_out + lane, false);
+                    pending &= pending - 1;
+                }
+                break;
+            }
+
+            // Test occupancy for every live lane
+            const __m256i active = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(pending), lane_bits), lane_bits);
+            const __m256i occupied = _mm256_andnot_si256(_mm256_cmpeq_epi32(gather_occupancies(ndx, active), zero_i), active);
+            u32 candidates = static_cast<u32>(_mm256_movemask_ps(_mm256_castsi256_ps(occupied)));
+            if (candidates != 0)
+            {
+                // Diverged lanes resolve chunks/voxels individually
+                spill();
+                while (candidates != 0)
+                {
+                    const u32 lane = _tzcnt_u32(candidates);
+                    const i32 lane_mc[3] = { mc_lanes[0][lane], mc_lanes[1][lane], mc_lanes[2][lane] };
+                    if (brick_step(rays[lane], lane_mc, static_cast<u32>(ndx_lanes[lane]), t_lanes[lane], static_cast<u8>(axis_lanes[lane]), lane_segs[lane], hits_out + lane, false))
+                    {
+                        pending &= ~(1u << lane);
+                    }
+                    candidates &= candidates - 1;
+                }
+            }
+
+            // Step every lane across its nearest metachunk boundary (branch-free axis selection)
+            const __m256 sel_x = _mm256_and_ps(_mm256_cmp_ps(t_max[0], t_max[1], _CMP_LT_OQ), _mm256_cmp_ps(t_max[0], t_max[2], _CMP_LT_OQ));
+            const __m256 sel_y = _mm256_andnot_ps(sel_x, _mm256_cmp_ps(t_max[1], t_max[2], _CMP_LT_OQ));
+            const __m256 sel_z = _mm256_andnot_ps(_mm256_or_ps(sel_x, sel_y), _mm256_castsi256_ps(_mm256_cmpeq_epi32(zero_i, zero_i)));
+            const __m256 sel[3] = { sel_x, sel_y, sel_z };
+            t = _mm256_min_ps(t_max[0], _mm256_min_ps(t_max[1], t_max[2]));
+            __m256i out_of_grid = zero_i;
+            for (u8 i = 0; i < 3; i++)
+            {
+                t_max[i] = _mm256_add_ps(t_max[i], _mm256_and_ps(sel[i], t_delta[i]));
+                mc[i] = _mm256_add_epi32(mc[i], _mm256_and_si256(_mm256_castps_si256(sel[i]), step_v[i]));
+                out_of_grid = _mm256_or_si256(out_of_grid, _mm256_or_si256(_mm256_cmpgt_epi32(zero_i, mc[i]),
+                                                                            _mm256_cmpgt_epi32(mc[i], _mm256_set1_epi32(num_metachunks_per_axis[i] - 1))));
+            }
+            axis = _mm256_or_si256(_mm256_and_si256(_mm256_castps_si256(sel_y), one_i),
+                                   _mm256_and_si256(_mm256_castps_si256(sel_z), _mm256_set1_epi32(2)));
+
+            // Retire lanes leaving the grid, or passing the ends of their segments
+            pending &= ~static_cast<u32>(_mm256_movemask_ps(_mm256_castsi256_ps(out_of_grid)));
+            pending &= ~static_cast<u32>(_mm256_movemask_ps(_mm256_cmp_ps(t, t_end, _CMP_GT_OQ)));
+        }
+    }
 };
 
 #ifdef GEOMETRY_DBG
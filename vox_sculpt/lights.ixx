@@ -1,6 +1,8 @@
 export module lights;
 
 import vmath;
+import vox_ints;
+import spectra;
 
 export namespace lights
 {
@@ -12,4 +14,115 @@ export namespace lights
         *pdf_out = (vmath::inv_pi * 0.25f); // Distantly remembered sphere pdf (1 / 4pi), not totally sure if its appropriate here
         return (1.0f / (sky_dist * sky_dist)) * sky_brightness;
     }
+
+    // Importance distribution for sky directions, used for next-event estimation (see [scene::sky_nee])
+    // [spectra::sky] only varies with wavelength & elevation, so we tabulate it over a grid of wavelength bins and elevation bands;
+    // bands are uniform in [y] (= equal solid angle), so directions only need to pick a band, then a uniform [y] within it & a
+    // uniform azimuth
+    // Bands are picked with one alias table per wavelength bin (Vose's method), so sampling costs one lookup + one compare
+    struct sky_distribution
+    {
+        static constexpr u32 num_rho_bins = 32;
+        static constexpr u32 num_bands = 64;
+        static constexpr float band_height = 2.0f / num_bands;
+        static constexpr float uniform_fraction = 0.05f; // Mixed in so every direction keeps a non-zero pdf (some wavelengths see almost no sky)
+        float accept[num_rho_bins][num_bands];
+        u8 alias[num_rho_bins][num_bands];
+        float band_pdf[num_rho_bins][num_bands]; // Per-band probabilities; solid-angle pdfs are these over [band_height * 2pi]
+
+        static u32 rho_bin(float rho)
+        {
+            return vmath::min(static_cast<u32>(vmath::max(rho, 0.0f) * num_rho_bins), num_rho_bins - 1);
+        }
+
+        void build()
+        {
+            for (u32 r = 0; r < num_rho_bins; r++)
+            {
+                const float rho = (r + 0.5f) / num_rho_bins;
+                float weights[num_bands];
+                float total = 0.0f;
+                for (u32 b = 0; b < num_bands; b++)
+                {
+                    weights[b] = spectra::sky(rho, -1.0f + ((b + 0.5f) * band_height));
+                    total += weights[b];
+                }
+                for (u32 b = 0; b < num_bands; b++)
+                {
+                    band_pdf[r][b] = (total > 0.0f) ? ((1.0f - uniform_fraction) * (weights[b] / total)) + (uniform_fraction / num_bands) :
+                                                      (1.0f / num_bands);
+                }
+
+                // Vose's alias method; split bands into under/over-full sets, then top up each under-full band from an over-full one
+                float scaled[num_bands];
+                u8 small[num_bands], large[num_bands];
+                u32 num_small = 0, num_large = 0;
+                for (u32 b = 0; b < num_bands; b++)
+                {
+                    scaled[b] = band_pdf[r][b] * num_bands;
+                    if (scaled[b] < 1.0f) small[num_small++] = static_cast<u8>(b);
+                    else large[num_large++] = static_cast<u8>(b);
+                }
+                while (num_small > 0 && num_large > 0)
+                {
+                    const u8 s = small[--num_small];
+                    const u8 l = large[--num_large];
+                    accept[r][s] = scaled[s];
+                    alias[r][s] = l;
+                    scaled[l] = (scaled[l] + scaled[s]) - 1.0f;
+                    if (scaled[l] < 1.0f) small[num_small++] = l;
+                    else large[num_large++] = l;
+                }
+                while (num_large > 0)
+                {
+                    const u8 l = large[--num_large];
+                    accept[r][l] = 1.0f;
+                    alias[r][l] = l;
+                }
+                while (num_small > 0) // Only reachable through rounding error
+                {
+                    const u8 s = small[--num_small];
+                    accept[r][s] = 1.0f;
+                    alias[r][s] = s;
+                }
+            }
+        }
+
+        // Draw a direction for wavelength [rho] from two uniform values
+        // The alias test only consumes part of [u], so the remainder is rescaled and reused for the offset within the chosen band
+        vmath::vec<3> sample(float rho, float u, float v, float* pdf_out) const
+        {
+            const u32 r = rho_bin(rho);
+            const float scaled_u = u * num_bands;
+            u32 band = vmath::min(static_cast<u32>(scaled_u), num_bands - 1);
+            float frac = vmath::min(scaled_u - band, 1.0f);
+            const float a = accept[r][band];
+            if (frac < a)
+            {
+                frac /= a;
+            }
+            else
+            {
+                frac = (frac - a) / vmath::max(1.0f - a, vmath::eps);
+                band = alias[r][band];
+            }
+            const float y = vmath::clamp(-1.0f + ((band + frac) * band_height), -1.0f, 1.0f);
+            const float xz = vmath::fsqrt(vmath::max(1.0f - (y * y), 0.0f));
+            const float phi = v * vmath::pi_2;
+            *pdf_out = band_pdf[r][band] / (band_height * vmath::pi_2);
+            return vmath::vec<3>(xz * vmath::fcos(phi), y, xz * vmath::fsin(phi));
+        }
+
+        // Solid-angle pdf for directions drawn by other strategies (used for MIS weights)
+        float pdf(float rho, vmath::vec<3> dir) const
+        {
+            const u32 band = vmath::min(static_cast<u32>(vmath::max(dir.e[1] + 1.0f, 0.0f) / band_height), num_bands - 1);
+            return band_pdf[rho_bin(rho)][band] / (band_height * vmath::pi_2);
+        }
+    };
+    sky_distribution sky_importance;
+    void init_sky_distribution()
+    {
+        sky_importance.build();
+    }
 };
\ No newline at end of file
@@ -25,9 +25,13 @@ export namespace materials
 {
     // Lambertian surfaces have constant reflection and no other spectrally-varying properties, so our spd just needs to take
     // the current sampled frequency + worldspace coordinates (for spatially-varying colours)
-    void diffuse_lambert_reflection(float rho, vmath::fn<4, const float> surf_spd, vmath::vec<3> coords, float* power, float* rho_weight)
+    // Evaluated once per wavelength lane (see [spectra::lanes]); power is shared by every lane
+    void diffuse_lambert_reflection(spectra::lanes rho, vmath::fn<4, const float> surf_spd, vmath::vec<3> coords, float* power, spectra::lanes* rho_weight)
     {
-        *rho_weight *= surf_spd.invoke(vmath::vec<4>(coords.x(), coords.y(), coords.z(), rho));
+        for (int i = 0; i < 4; i++)
+        {
+            rho_weight->e[i] *= surf_spd.invoke(vmath::vec<4>(coords.x(), coords.y(), coords.z(), rho.e[i]));
+        }
         *power *= vmath::inv_pi;
     }
 
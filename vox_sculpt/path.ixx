@@ -2,6 +2,7 @@ export module path;
 
 import vmath;
 import materials;
+import spectra;
 import vox_ints;
 import platform;
 
@@ -9,17 +10,20 @@ export namespace tracing
 {
     struct path_vt
     {
-        path_vt(vmath::vec<3> _dir, vmath::vec<3> _ori, float _pdf, float _rho, float _rho_weight, float _power) :
+        path_vt() {}
+        path_vt(vmath::vec<3> _dir, vmath::vec<3> _ori, float _pdf, spectra::lanes _rho, spectra::lanes _rho_weight, float _power) :
             dir(_dir), ori(_ori), pdf(_pdf), rho_weight(_rho_weight), rho_sample(_rho), power(_power) {}
         vmath::vec<3> dir;
         vmath::vec<3> ori;
         float pdf = 1.0f; // Perspective-projected lens probabilities initialize at 100%; there's a proof somewhere, but naively
                           // we know that every sensor/film cell is sampled exactly once and every sensor/film cell *must* be sampled
                           // for a full image, so the relative probability for each sensor can never be less/greater than 1
-        float rho_weight = 1.0f; // Totally dependant on the average scene SPD to be meaningful; initialize to 1 to hint that all colours
-                                 // should be reflected by all rays by default
-        float rho_sample = 0.5f; // Place path spectra near the white-point of our film response curve (see camera.h) by default
+        spectra::lanes rho_weight = 1.0f; // Totally dependant on the average scene SPD to be meaningful; initialize to 1 to hint that all colours
+                                          // should be reflected by all rays by default
+        spectra::lanes rho_sample = 0.5f; // Place path spectra near the white-point of our film response curve (see camera.h) by default
+                                          // One weight/wavelength per lane, see [spectra::hero_wavelengths]
         float power = 1.0f; // Lights have unit energy by default (spikes up to light source wattage for final/starting verts)
+        vmath::vec<3> normal; // Surface normal at scattering vertices, zero for camera/sky vertices (needed to connect light/camera paths)
         materials::instance* mat = nullptr; // Material at the intersection point, to allow recalculating shading as needed for light/camera path connections
     };
 
@@ -36,10 +40,10 @@ export namespace tracing
                 size++;
             }
 
-            void resolve_path_weights(float* rho_out, float* pdf_out, float* response_out, float* power_out)
+            void resolve_path_weights(spectra::lanes* rho_out, float* pdf_out, spectra::lanes* response_out, float* power_out)
             {
                 float pdf = 1.0f;
-                float response = 1.0f;
+                spectra::lanes response = 1.0f;
                 float power = 1.0f;
                 *rho_out = vts[0].rho_sample;
                 for (u32 i = 0; i < size; i++)
@@ -76,4 +80,181 @@ export namespace tracing
                                                   // allow rays to walk through 1734 cells (top-right to bottom-left corner)
             path_vt vts[capacity];
     };
+
+    // Streaming alternative to [path]; folds each vertex into the products from [path::resolve_path_weights] as soon as it's
+    // generated, so unidirectional integration never stores (or re-walks) full vertex lists
+    // Products are taken in the same order as [resolve_path_weights], so both resolve to identical weights
+    // Bidirectional schemes still need [path] to connect vertices after tracing
+    class path_accumulator
+    {
+        public:
+            u16 size = 0;
+            void push(const path_vt& vt)
+            {
+                if (size == 0)
+                {
+                    rho = vt.rho_sample;
+#ifdef HIGHLIGHT_SURFACES
+                    first_vt_surface = (vt.mat != nullptr);
+#endif
+                }
+                else
+                {
+                    power *= last_dir.dot(vt.dir);
+                }
+                pdf *= vt.pdf;
+                response *= vt.rho_weight;
+                power *= vt.power;
+                last_dir = vt.dir;
+                size++;
+            }
+
+            void resolve_path_weights(spectra::lanes* rho_out, float* pdf_out, spectra::lanes* response_out, float* power_out)
+            {
+                *rho_out = rho;
+                *pdf_out = pdf;
+                *response_out = response;
+                *power_out = power;
+#ifdef HIGHLIGHT_SURFACES
+                if (first_vt_surface)
+                {
+                    *response_out = 1.0f;
+                    *rho_out = 0.85f;
+                }
+#endif
+            }
+
+            // Paths without any vertices (absorbed before scattering) resolve with the camera vertex's spectral sample
+            explicit path_accumulator(spectra::lanes init_rho) : rho(init_rho) {}
+
+        private:
+            spectra::lanes rho = 0.5f;
+            float pdf = 1.0f;
+            spectra::lanes response = 1.0f;
+            float power = 1.0f;
+            vmath::vec<3> last_dir;
+#ifdef HIGHLIGHT_SURFACES
+            bool first_vt_surface = false;
+#endif
+    };
+
+    // Structure-of-arrays ray queue for wavefront integration (see [tracing::wavefront_image_integrator])
+    // Wavefront paths never store full vertex lists; instead they carry running products of the per-vertex terms in [path::resolve_path_weights],
+    // plus the current vertex (the [out_vt] in [scene::isect]) so that we can keep scattering from it
+    struct ray_queue
+    {
+        static constexpr u32 capacity = 2048; // Small enough for each stage's working set to stay in L2
+        u32 size = 0;
+
+        // Current ray
+        float ori[3][capacity];
+        float dir[3][capacity];
+        u32 pixel_ndx[capacity];
+        spectra::lanes rho_sample[capacity]; // Spectral terms keep their lanes together, since every stage touches all four at once
+
+        // Current vertex weights
+        float pdf[capacity];
+        spectra::lanes rho_weight[capacity];
+        float power[capacity];
+
+        // Running path weights
+        float path_pdf[capacity];
+        spectra::lanes path_response[capacity];
+        float path_power[capacity];
+        u16 num_vts[capacity];
+        spectra::lanes nee[capacity]; // Sky light gathered by next-event estimation (see [scene::sky_nee]), in resolved path weight units
+
+        // Traversal state + outputs from the extend stage
+        u8 within_grid[capacity];
+        u8 hit[capacity];
+        u8 hit_axis[capacity];
+        float hit_t[capacity];
+
+        // Primary hit cache slot for each camera ray (pixel index * [aa::max_samples] + subpixel index)
+        u32 hit_cache_ndx[capacity];
+
+        // Initialize a new path at the back of the queue from a camera vertex
+        void push(path_vt cam_vt, u32 ndx, u32 cache_ndx)
+        {
+            const u32 i = size;
+            for (u8 j = 0; j < 3; j++)
+            {
+                ori[j][i] = cam_vt.ori.e[j];
+                dir[j][i] = cam_vt.dir.e[j];
+            }
+            pixel_ndx[i] = ndx;
+            hit_cache_ndx[i] = cache_ndx;
+            rho_sample[i] = cam_vt.rho_sample;
+            pdf[i] = cam_vt.pdf;
+            rho_weight[i] = cam_vt.rho_weight;
+            power[i] = cam_vt.power;
+            path_pdf[i] = 1.0f;
+            path_response[i] = 1.0f;
+            path_power[i] = 1.0f;
+            num_vts[i] = 0;
+            nee[i] = 0.0f;
+            within_grid[i] = 0;
+            hit[i] = 0;
+            size++;
+        }
+
+        // Fold a new vertex into the running path weights; [path::resolve_path_weights] scales power by the cosine between each pair of consecutive
+        // vertices, so we apply that against the previous direction before overwriting it
+        void append_vt(u32 i, vmath::vec<3> vt_dir, float vt_pdf, spectra::lanes vt_rho_weight, float vt_power)
+        {
+            path_pdf[i] *= vt_pdf;
+            path_response[i] *= vt_rho_weight;
+            path_power[i] *= vt_power;
+            if (num_vts[i] > 0)
+            {
+                path_power[i] *= (dir[0][i] * vt_dir.e[0]) + (dir[1][i] * vt_dir.e[1]) + (dir[2][i] * vt_dir.e[2]);
+            }
+            num_vts[i]++;
+        }
+
+        // Move path [src] into slot [dst] during compaction
+        void move(u32 dst, u32 src)
+        {
+            for (u8 j = 0; j < 3; j++)
+            {
+                ori[j][dst] = ori[j][src];
+                dir[j][dst] = dir[j][src];
+            }
+            pixel_ndx[dst] = pixel_ndx[src];
+            rho_sample[dst] = rho_sample[src];
+            pdf[dst] = pdf[src];
+            rho_weight[dst] = rho_weight[src];
+            power[dst] = power[src];
+            path_pdf[dst] = path_pdf[src];
+            path_response[dst] = path_response[src];
+            path_power[dst] = path_power[src];
+            num_vts[dst] = num_vts[src];
+            nee[dst] = nee[src];
+            within_grid[dst] = within_grid[src];
+        }
+    };
+
+    // Completed wavefront paths, waiting to be splatted onto the sensor
+    struct splat_queue
+    {
+        u32 size = 0;
+        u32 pixel_ndx[ray_queue::capacity];
+        spectra::lanes rho[ray_queue::capacity];
+        spectra::lanes rho_weight[ray_queue::capacity];
+        float pdf[ray_queue::capacity];
+        float power[ray_queue::capacity];
+        spectra::lanes nee[ray_queue::capacity];
+
+        // Resolve the path in slot [i] of [rays] into a splat
+        void push(const ray_queue& rays, u32 i)
+        {
+            pixel_ndx[size] = rays.pixel_ndx[i];
+            rho[size] = rays.rho_sample[i];
+            rho_weight[size] = rays.path_response[i];
+            pdf[size] = rays.path_pdf[i];
+            power[size] = rays.path_power[i];
+            nee[size] = rays.nee[i];
+            size++;
+        }
+    };
 }
@@ -18,9 +18,125 @@ import lights;
 #endif
 export namespace scene
 {
+    // Next-event estimation for sky lighting
+    // Diffuse vertices draw one extra direction from [lights::sky_importance] and trace it for occlusion; directions reaching the sky
+    // that way and BSDF-sampled paths escaping into the sky both estimate the same integral, so each is weighted against the other
+    // strategy's pdf (balance heuristic)
+    // NEE draws reuse the two random values BSDF sampling leaves unused, so paths scatter identically with NEE enabled or disabled
+#define SKY_NEE
+
+    // MIS weight for paths escaping along [dir] after BSDF sampling with pdf [bsdf_pdf]
+    // Light densities always come from the hero wavelength ([rho]), the same one [sky_nee] samples with, so one weight covers every lane
+    float sky_bsdf_weight(float rho, vmath::vec<3> dir, float bsdf_pdf)
+    {
+        return bsdf_pdf / (bsdf_pdf + lights::sky_importance.pdf(rho, dir));
+    }
+
+    // Sky contribution for one NEE direction at the diffuse vertex [ori] (with [normal] & incoming direction [in_dir]), already MIS-weighted
+    // Returned values are in resolved path weight units (response * power / pdf, see [path::resolve_path_weights]); [path_weight] is that
+    // value for the path before the current vertex, and [rho_weight]/[power] are the weights we'd append when scattering from it
+    // Directions are drawn for the hero wavelength and shared by every lane
+    // Paths never scatter past their [last_vt] (see [continue_path]), so BSDF sampling can't reach the sky from there; NEE takes full
+    // weight at those vertices instead of splitting it with a strategy that never runs
+    spectra::lanes sky_nee(vmath::vec<3> ori, vmath::vec<3> normal, vmath::vec<3> in_dir, bool first_vt, bool last_vt, spectra::lanes rho,
+                           spectra::lanes path_weight, spectra::lanes rho_weight, float power, float u, float v)
+    {
+        float light_pdf = 0.0f;
+        vmath::vec<3> dir = lights::sky_importance.sample(rho.e[0], u, v, &light_pdf);
+        const float cos_n = dir.dot(normal);
+        if (cos_n <= 0.0f || light_pdf <= 0.0f) return 0.0f;
+        if (geometry::dda_occluded(geometry::make_dda_ray(ori, dir), geometry::dda_segment(), true)) return 0.0f; // Same self-intersection rules as bounce rays
+        const float bsdf_pdf = cos_n * vmath::inv_pi;
+        float sky_pdf = 0.0f;
+        const float sky_power = power * lights::sky_env(&sky_pdf);
+        const float cos_prev = first_vt ? 1.0f : in_dir.dot(dir);
+        const float mis_pdf = last_vt ? light_pdf : light_pdf + bsdf_pdf;
+        return (path_weight * rho_weight * spectra::sky(rho, dir.e[1])) * ((power * cos_prev * sky_power) / (sky_pdf * mis_pdf));
+    }
+
+    // Path termination
+    // Past [min_depth] scattering events, paths survive each further bounce with probability equal to their throughput (resolved path weight,
+    // clamped into [rr_min_survival...1]); survivors divide through by that probability, so expected contributions stay the same
+    // Paths stop outright after [max_bounces] scattering events; that truncates light transport (biased, unlike roulette), but bounds the
+    // cost of paths trapped inside noisy solid regions
+    // Terminated paths keep any light they gathered through NEE, but nothing from beyond their final vertex
+    struct path_termination
+    {
+        u16 min_depth = 3;
+        u16 max_bounces = 64;
+    };
+#define RUSSIAN_ROULETTE
+    constexpr float rr_min_survival = 0.05f; // Keeps survivor weights bounded (at most 20x)
+
+    // Decide whether a path continues past its [depth]th scattering event; writes the survival probability to [survival_out]
+    // [throughput] is averaged over wavelength lanes (see [spectra::lanes_mean])
+    bool continue_path(path_termination term, u32 depth, float throughput, u32 tileNdx, float* survival_out)
+    {
+        *survival_out = 1.0f;
+        if (depth >= term.max_bounces) return false;
+#ifdef RUSSIAN_ROULETTE
+        if (depth >= term.min_depth)
+        {
+            const float survival = vmath::clamp(vmath::fabs(throughput), rr_min_survival, 1.0f); // Path weights pick up signed cosines between consecutive directions
+            if (survival < 1.0f)
+            {
+                float sample[4];
+                parallel::rand_streams[tileNdx].next(sample);
+                if (sample[0] >= survival) return false;
+                *survival_out = survival;
+            }
+        }
+#endif
+        return true;
+    }
+
+    // Path length histograms (scattering events per path, per-tile), logged by [tracing::trace] as tiles finish
+//#define PATH_LENGTH_STATS
+#ifdef PATH_LENGTH_STATS
+    constexpr bool path_length_stats_enabled = true;
+#else
+    constexpr bool path_length_stats_enabled = false;
+#endif
+    constexpr u32 path_length_bins = 65; // The last bin collects everything longer
+    u64* path_length_histograms = nullptr; // [path_length_bins] counters per tile; allocated by [tracing::init] when stats are enabled
+    void record_path_length(u32 tileNdx, u32 depth)
+    {
+        if constexpr (path_length_stats_enabled)
+        {
+            path_length_histograms[(tileNdx * path_length_bins) + vmath::min(depth, path_length_bins - 1)]++;
+        }
+    }
+
+    void log_path_lengths(u32 tileNdx)
+    {
+        if constexpr (path_length_stats_enabled)
+        {
+            const u64* histogram = path_length_histograms + (tileNdx * path_length_bins);
+            u64 num_paths = 0, total_depth = 0;
+            for (u32 i = 0; i < path_length_bins; i++)
+            {
+                num_paths += histogram[i];
+                total_depth += histogram[i] * i;
+            }
+            platform::osDebugLogFmt("tile %u path lengths: %llu paths, mean %f scattering events \n", tileNdx, num_paths,
+                                    static_cast<double>(total_depth) / vmath::max(num_paths, static_cast<u64>(1)));
+            for (u32 i = 0; i < path_length_bins; i++)
+            {
+                if (histogram[i] == 0) continue;
+                platform::osDebugLogFmt("    %u%s: %llu (%f%%)\n", i, (i == path_length_bins - 1) ? "+" : "", histogram[i], (100.0 * histogram[i]) / num_paths);
+            }
+        }
+    }
+
     // Traverse the scene, pass path vertices back up to our pipeline so they can be integrated separately from scene traversal
     // (allowing for BDPT/VCM and other integration schemes besides regular unidirectional)
-    void isect(tracing::path_vt init_vt, tracing::path* vertex_output, float* isosurf_dist, u32 tileNdx)
+    // [vertex_output] can be a full [tracing::path], or a [tracing::path_accumulator] for streaming unidirectional integration
+    // Callers that have already traversed the primary ray (e.g. through [geometry::packet_isect]) can pass the result in [primary_hit]; we
+    // skip the first grid traversal in that case. [primary_hit] distances are measured from the grid intersection given by [geometry::test]
+    // Sky light gathered by next-event estimation is accumulated into [nee_out] (when given), in resolved path weight units
+    template<typename path_output>
+    void isect(tracing::path_vt init_vt, path_output* vertex_output, float* isosurf_dist, u32 tileNdx, const geometry::traversal_hit* primary_hit = nullptr,
+               spectra::lanes* nee_out = nullptr, path_termination term = path_termination())
     {
         float horizon_dist = 1000.0f;
         typedef tracing::path_vt ray;
@@ -31,6 +147,10 @@ export namespace scene
         u8 bounceCtr = 0;
         geometry::vol::vol_nfo volume_nfo;
         bool within_grid = geometry::test(curr_ray.dir, &curr_ray.ori, &volume_nfo);
+        float run_pdf = 1.0f, run_power = 1.0f; // Running path weights, same products as [path::resolve_path_weights]
+        spectra::lanes run_response = 1.0f;
+        float bsdf_pdf = 1.0f; // BSDF pdf for the latest scattered direction (vertex pdfs also carry roulette survival probabilities)
+        u32 depth = 0; // Scattering events so far
         //#define VALIDATE_VERTEX_COUNTS
         //#define PROPAGATION_DBG
         //#define VALIDATE_BOUNCES
@@ -40,7 +160,7 @@ export namespace scene
 #endif
         //bool mask_current_cell = false; // Flag preventing self-intersection when we're bouncing out of volume cells
 #ifdef VALIDATE_VERTEX_COUNTS
-        u32 init_vt_count = vertex_output->front;
+        u32 init_vt_count = vertex_output->size;
 #endif
         while (!path_absorbed && !path_escaped)
         {
@@ -52,15 +172,15 @@ export namespace scene
                 /////////////////////////////////////////////////////////
 
                 // Special case for silhouettes; if we've just hit the grid boundaries, jump to the surface instead of recalculating that distance every sample
-                if (first_grid_hit && *isosurf_dist > -1.0f) // Isosurface distances initialize to [-1]; zero distances are reserved for subpixels that immediately touch a grid boundary
+                if (first_grid_hit && primary_hit == nullptr && *isosurf_dist > -1.0f) // Isosurface distances initialize to [-1]; zero distances are reserved for subpixels that immediately touch a grid boundary
                 {
                     curr_ray.ori += curr_ray.dir * *isosurf_dist;
                 }
 
                 // Sometimes rays land "outside" the volume because of floating-point error; normalize those cases here
                 curr_ray.ori = vmath::clamp(curr_ray.ori,
-                                            vmath::vec<3>(volume_nfo.transf.pos - volume_nfo.transf.scale * 0.5f),
-                                            vmath::vec<3>(volume_nfo.transf.pos + volume_nfo.transf.scale * 0.5f));
+                                            geometry::vol::view.bounds_min,
+                                            geometry::vol::view.bounds_max);
 
                 // March from the current position to the first cell with non-zero state
                 ////////////////////////////////////////////////////////////////////////
@@ -71,18 +191,36 @@ export namespace scene
                 vmath::vec<3> voxel_normal = vmath::vec<3>(0, 0, -1); // Normals, initialized to something mostly safe (for the default z-aligned view anyways)
 
                 // Resolve intersection cell each tap
-                vmath::vec<3> rel_p = (curr_ray.ori - volume_nfo.transf.pos) + (volume_nfo.transf.scale * 0.5f); // Relative position from lower object corner
-                vmath::vec<3> uvw = rel_p / volume_nfo.transf.scale; // Normalized UVW
-                vmath::vec<3> uvw_scaled = uvw * geometry::vol::width; // Voxel coordinates! :D
+                // (relative position from the lower object corner, normalized, then scaled into voxel coordinates; folded into one
+                // scale/offset per-view, see [geometry::vol::resolve_view])
+                vmath::vec<3> uvw_scaled = (curr_ray.ori * geometry::vol::view.world_to_voxel_scale) + geometry::vol::view.world_to_voxel_offs; // Voxel coordinates! :D
                 vmath::vec<3, i32> uvw_i = vmath::vec3_cast<vmath::vec<3>, vmath::vec<3, i32>>(vmath::vfloor(vmath::vabs(uvw_scaled))); // Probably paranoid, but voxel coordinates should never be negative
 
-                // Find the next cell intersection, and step into it before recalculating rel_p/uvw & checking occupancy again
+                // Find the next cell intersection, and step into it before recalculating uvw & checking occupancy again
                 // Using DDA means that cell steps travel directly to geometry, so any stepping failures mean that our rays leave geometry completely
 //#define VALIDATE_STEPPED_RO
 #ifdef VALIDATE_STEPPED_RO
                 vmath::vec<3> ro_input = curr_ray.ori;
 #endif
-                const bool cell_step_success = geometry::cell_step(curr_ray.dir, &curr_ray.ori, uvw_scaled, &uvw_i, &voxel_normal, first_grid_hit);
+                // Primary traversal may have been resolved ahead of time; otherwise run the DDA kernel from the current position
+                // (bounce rays skip the voxel they're leaving, primary rays can hit their starting voxel)
+                geometry::traversal_hit grid_hit;
+                if (first_grid_hit && primary_hit != nullptr)
+                {
+                    grid_hit = *primary_hit;
+                }
+                else
+                {
+                    geometry::dda_isect(geometry::make_dda_ray(curr_ray.ori, curr_ray.dir), &grid_hit, !first_grid_hit);
+                }
+                const bool cell_step_success = grid_hit.hit;
+                if (cell_step_success)
+                {
+                    curr_ray.ori = grid_isect_pos + (curr_ray.dir * grid_hit.t);
+                    uvw_i = grid_hit.voxel;
+                    voxel_normal = vmath::vec<3>(0.0f);
+                    voxel_normal.e[grid_hit.axis] = curr_ray.dir.e[grid_hit.axis] >= 0.0f ? -1.0f : 1.0f;
+                }
                 if (!cell_step_success) // No intersections along the given direction :(
                 {
                     uvw_i = vmath::vmax(uvw_i, vmath::vec<3, i32>(0, 0, 0));
@@ -111,10 +249,10 @@ export namespace scene
                 if (within_grid)
                 {
                     // Sample surfaces (just lambertian diffuse for now)
+                    float sample[4]; // BSDF sampling takes the first two values, NEE (when enabled) takes the rest
                     switch (volume_nfo.mat.material_type)
                     {
                         case material_labels::DIFFUSE:
-                            float sample[4];
                             parallel::rand_streams[tileNdx].next(sample);
                             materials::diffuse_surface_sample(&out_vt.dir, &out_vt.pdf, sample[0], sample[1]);
                             materials::diffuse_lambert_reflection(out_vt.rho_sample, volume_nfo.mat.spectral_response, curr_ray.ori, &out_vt.power, &out_vt.rho_weight);
@@ -131,7 +269,8 @@ export namespace scene
                     // treat my voxels like diffuse flakes instead of trying to force them into clean boxes that never experience translucency
                     // (it's definitely not physically accurate translucency but eh, like, self-intersections seem quite rare, I'm not sure how problematic
                     // that will be in practice)
-                    if (curr_ray.rho_weight <= vmath::eps ||
+                    // Spectral absorption only counts once every lane has been absorbed
+                    if (spectra::lanes_max(curr_ray.rho_weight) <= vmath::eps ||
                         curr_ray.power <= vmath::eps ||
                         curr_ray.pdf <= vmath::eps)
                     {
@@ -144,7 +283,30 @@ export namespace scene
                         vmath::m3 nSpace = vmath::normalSpace(voxel_normal);
                         out_vt.dir = nSpace.apply(out_vt.dir).normalized();
                         out_vt.ori = curr_ray.ori;
+                        out_vt.normal = voxel_normal;
                         out_vt.mat = &volume_nfo.mat;
+#ifdef SKY_NEE
+                        if (nee_out != nullptr && run_pdf > 0.0f)
+                        {
+                            *nee_out += sky_nee(out_vt.ori, voxel_normal, curr_ray.dir, depth == 0, (depth + 1) >= term.max_bounces, out_vt.rho_sample,
+                                                (run_response * run_power) / run_pdf, out_vt.rho_weight, out_vt.power, sample[2], sample[3]);
+                        }
+#endif
+                        run_pdf *= out_vt.pdf;
+                        run_response *= out_vt.rho_weight;
+                        run_power *= out_vt.power * (depth > 0 ? curr_ray.dir.dot(out_vt.dir) : 1.0f);
+                        bsdf_pdf = out_vt.pdf;
+                        depth++;
+
+                        // Roulette/bounce limits
+                        float survival = 1.0f;
+                        if (!continue_path(term, depth, run_pdf > 0.0f ? (spectra::lanes_mean(run_response) * run_power) / run_pdf : 0.0f, tileNdx, &survival))
+                        {
+                            out_vt.power = 0.0f;
+                            path_absorbed = true;
+                        }
+                        out_vt.pdf *= survival;
+                        run_pdf *= survival;
 
                         // Cache path vertex for integration
                         vertex_output->push(out_vt);
@@ -157,7 +319,7 @@ export namespace scene
 #endif
 #endif
 #ifdef VALIDATE_VERTEX_COUNTS
-                        parallel::append_tile_log(tileNdx, "vertex count %i, initially %i, \n", vertex_output->front, init_vt_count);
+                        parallel::append_tile_log(tileNdx, "vertex count %i, initially %i, \n", vertex_output->size, init_vt_count);
 #endif
                         // Update current ray
                         curr_ray = out_vt;
@@ -168,6 +330,7 @@ export namespace scene
             {
                 // Map exiting rays onto the sky (set 1000 units from the scene origin)
                 out_vt.ori = curr_ray.ori + (curr_ray.dir * lights::sky_dist);
+                out_vt.normal = vmath::vec<3>(0.0f);
 
                 // Sample our sky model (super wip)
 //#define DEBUG_RED_SKY
@@ -176,6 +339,12 @@ export namespace scene
                 out_vt.rho_weight = 1.0f;
 #else
                 out_vt.rho_weight = spectra::sky(out_vt.rho_sample, out_vt.dir.e[1]);
+#ifdef SKY_NEE
+                if (nee_out != nullptr && depth > 0)
+                {
+                    out_vt.power *= sky_bsdf_weight(out_vt.rho_sample.e[0], out_vt.dir, bsdf_pdf);
+                }
+#endif
                 out_vt.power *= lights::sky_env(&out_vt.pdf);
 #endif
 
@@ -194,6 +363,347 @@ export namespace scene
             // Update bounce counter (escaped rays still bounce exactly once off the sky)
             bounceCtr++;
         }
+        record_path_length(tileNdx, depth);
+    }
+
+    // Bidirectional path tracing
+    // Camera subpaths come from [isect] as usual; light subpaths start on a disc facing a direction drawn from [lights::sky_importance]
+    // (wide enough to cover the grid's bounding sphere), then scatter through the volume with [isect] as well
+    // Every camera vertex connects to the sky (NEE) and to every light vertex through occlusion queries; each resulting path is weighted
+    // against every other strategy able to produce it (balance heuristic), including BSDF-sampled camera paths escaping into the sky
+    // Light subpaths never connect to the lens (no light tracing), so every path keeps at least one camera vertex
+    // Paths are evaluated with the same products as [path::resolve_path_weights], so results stay in the same units as the
+    // unidirectional integrators; strategy pdfs are compared in area measure (solid angle for the final sky direction)
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    constexpr u32 bdpt_max_subpath_vts = 8; // Compounded vertex powers stay well above the absorption cutoffs in [isect] at these depths, so
+                                            // every strategy agrees on which paths it can generate
+    constexpr path_termination bdpt_termination = { bdpt_max_subpath_vts, bdpt_max_subpath_vts }; // No roulette (survival probabilities would
+                                                                                                 // need to enter every MIS weight)
+
+    // Open a light subpath for wavelength [rho]; writes the direction back towards the sky in [sky_dir_out], and the area density of
+    // ray origins on the light disc in [disc_pdf_out]
+    // Light subpaths carry the same wavelength lanes as camera subpaths; directions come from the hero wavelength
+    tracing::path_vt bdpt_light_vt(spectra::lanes rho, const float* sample, vmath::vec<3>* sky_dir_out, float* disc_pdf_out)
+    {
+        float light_pdf = 0.0f;
+        const vmath::vec<3> sky_dir = lights::sky_importance.sample(rho.e[0], sample[0], sample[1], &light_pdf);
+        const vmath::vec<3> centre = (geometry::vol::view.bounds_min + geometry::vol::view.bounds_max) * 0.5f;
+        const float radius = (geometry::vol::view.bounds_max - geometry::vol::view.bounds_min).magnitude() * 0.5f;
+        const float disc_r = radius * vmath::fsqrt(sample[2]);
+        const float disc_phi = sample[3] * vmath::pi_2;
+        const vmath::vec<3> disc_offs = vmath::normalSpace(sky_dir).apply(vmath::vec<3>(disc_r * vmath::fcos(disc_phi), disc_r * vmath::fsin(disc_phi), 0.0f));
+        *sky_dir_out = sky_dir;
+        *disc_pdf_out = 1.0f / (vmath::pi * radius * radius);
+        return tracing::path_vt(sky_dir * -1.0f, centre + disc_offs + (sky_dir * (radius * 2.0f)), 1.0f, rho, 1.0f, 1.0f);
+    }
+
+    // Visibility between two scattering vertices; the segment stops half a voxel short of [b], so the voxel holding [b] never
+    // occludes it
+    bool bdpt_visible(vmath::vec<3> a, vmath::vec<3> b)
+    {
+        vmath::vec<3> dir = b - a;
+        const float dist = dir.magnitude();
+        const vmath::vec<3>& voxel_size = geometry::vol::view.voxel_to_world_scale;
+        geometry::dda_segment seg;
+        seg.t_max = dist - (0.5f * vmath::min(voxel_size.e[0], vmath::min(voxel_size.e[1], voxel_size.e[2])));
+        if (seg.t_max <= 0.0f) return true;
+        return !geometry::dda_occluded(geometry::make_dda_ray(a, dir / dist), seg, true);
+    }
+
+    // MIS-weighted contribution for the complete path [camera] -> [vts[0]]...[vts[num_vts - 1]] -> sky (along [sky_dir]), in resolved path
+    // weight units; every strategy producing the same path returns the same value here (its estimate times its balance weight)
+    // [disc_pdf] is the light disc density from [bdpt_light_vt]; vertices must be scattering vertices (non-zero normals)
+    // Strategy densities use the hero wavelength throughout, so every lane shares one set of MIS weights
+    spectra::lanes bdpt_path_value(const tracing::path_vt* const* vts, u32 num_vts, vmath::vec<3> cam_dir, float cam_power, vmath::vec<3> sky_dir,
+                                   spectra::lanes rho, float disc_pdf)
+    {
+        if (num_vts == 0) return 0.0f;
+        constexpr u32 max_path_vts = bdpt_max_subpath_vts * 2;
+        float cos_in[max_path_vts], cos_out[max_path_vts], dist_sq[max_path_vts];
+        const materials::instance& mat = geometry::vol::metadata->mat;
+
+        // Unidirectional path weights, same products as [isect] + [path::resolve_path_weights]
+        float pdf = 1.0f, power = 1.0f;
+        float vt_power = cam_power;
+        spectra::lanes response = 1.0f, vt_response = 1.0f;
+        vmath::vec<3> in_dir = cam_dir;
+        for (u32 k = 0; k < num_vts; k++)
+        {
+            vmath::vec<3> out_dir = sky_dir;
+            if (k + 1 < num_vts)
+            {
+                out_dir = vts[k + 1]->ori - vts[k]->ori;
+                dist_sq[k + 1] = out_dir.sqr_magnitude();
+                out_dir = out_dir / vmath::fsqrt(dist_sq[k + 1]);
+            }
+            vmath::vec<3> normal = vts[k]->normal;
+            cos_in[k] = -normal.dot(in_dir);
+            cos_out[k] = normal.dot(out_dir);
+            if (cos_in[k] <= 0.0f || cos_out[k] <= 0.0f) return 0.0f; // Connections through the back of a voxel face
+            materials::diffuse_lambert_reflection(rho, mat.spectral_response, vts[k]->ori, &vt_power, &vt_response);
+            pdf *= cos_out[k] * vmath::inv_pi;
+            response *= vt_response;
+            power *= vt_power;
+            if (k > 0) power *= in_dir.dot(out_dir);
+            in_dir = out_dir;
+        }
+        float sky_pdf = 0.0f;
+        response *= spectra::sky(rho, sky_dir.e[1]);
+        power *= vt_power * lights::sky_env(&sky_pdf);
+        pdf *= sky_pdf;
+
+        // Sum strategy pdfs relative to BSDF sampling (the unidirectional strategy); moving the light subpath one vertex further
+        // towards the camera swaps one camera-side density for one light-side density
+        // Unidirectional paths escape after at most [max_bounces - 1] scattering events, since [continue_path] stops them at the last one
+        const u32 max_vts = bdpt_termination.max_bounces;
+        const float bsdf_sky_pdf = cos_out[num_vts - 1] * vmath::inv_pi;
+        float ratio = lights::sky_importance.pdf(rho.e[0], sky_dir) / bsdf_sky_pdf;
+        float strategies = 0.0f;
+        if (num_vts < max_vts) strategies += 1.0f;
+        if (num_vts <= max_vts) strategies += ratio; // NEE
+        for (u32 s = num_vts - 1; s >= 1; s--) // [s] camera vertices, [num_vts - s] light vertices
+        {
+            const float camera_density = (cos_out[s - 1] * vmath::inv_pi) * cos_in[s] / dist_sq[s];
+            const float light_density = (s == num_vts - 1) ? cos_out[s] * disc_pdf :
+                                                             (cos_in[s + 1] * vmath::inv_pi) * cos_out[s] / dist_sq[s + 1];
+            ratio *= light_density / camera_density;
+            if (s <= max_vts && (num_vts - s) <= max_vts) strategies += ratio;
+        }
+        if (strategies <= 0.0f || pdf <= 0.0f) return 0.0f;
+        return response * (power / (pdf * strategies));
+    }
+
+    // Wavefront stages
+    // These run the same scattering maths as [isect], but one stage at a time over a whole queue of paths
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Extend; find the next grid intersection for every path in [rays]
+    // Fresh camera rays are moved onto the grid boundary and traversed in packets, bounce rays are traversed individually
+    // Camera rays with valid entries in [hit_cache] reuse them and skip traversal; everything else writes its result back
+    // Camera rays are also clipped to the brick depth spans in [depth_map] (when given), and skip traversal through empty pixels
+    void extend(tracing::ray_queue* rays, bool camera_rays, geometry::primary_hit_cache* hit_cache = nullptr, const geometry::brick_depth_map* depth_map = nullptr)
+    {
+        if (camera_rays)
+        {
+            geometry::dda_ray packet[geometry::packet_width];
+            geometry::dda_segment segs[geometry::packet_width];
+            geometry::traversal_hit hits[geometry::packet_width];
+            geometry::traversal_hit cached_hits[geometry::packet_width];
+            const u32 version = geometry::primary_hit_cache::current_version(); // Read before the view, so hits traced across spins/zooms are
+                                                                                // cached under the view they were traced against
+            for (u32 base = 0; base < rays->size; base += geometry::packet_width)
+            {
+                const u32 num_lanes = vmath::min(rays->size - base, geometry::packet_width);
+                u8 lane_mask = 0;
+                u8 cached_mask = 0;
+                u8 skipped_mask = 0; // Lanes resolved as misses by [depth_map]
+                for (u32 lane = 0; lane < num_lanes; lane++)
+                {
+                    const u32 i = base + lane;
+                    const vmath::vec<3> cam_ori(rays->ori[0][i], rays->ori[1][i], rays->ori[2][i]);
+                    vmath::vec<3> ori = cam_ori;
+                    const vmath::vec<3> dir(rays->dir[0][i], rays->dir[1][i], rays->dir[2][i]);
+                    geometry::vol::vol_nfo volume_nfo;
+                    rays->within_grid[i] = geometry::test(dir, &ori, &volume_nfo);
+                    if (rays->within_grid[i])
+                    {
+                        // Same floating-point cleanup as [isect]
+                        ori = vmath::clamp(ori,
+                                           geometry::vol::view.bounds_min,
+                                           geometry::vol::view.bounds_max);
+                        rays->ori[0][i] = ori.e[0];
+                        rays->ori[1][i] = ori.e[1];
+                        rays->ori[2][i] = ori.e[2];
+                        if (hit_cache != nullptr && hit_cache->lookup_version(rays->hit_cache_ndx[i], version, cached_hits + lane))
+                        {
+                            cached_mask |= (1 << lane);
+                        }
+                        else if (depth_map != nullptr && !depth_map->segment(rays->pixel_ndx[i], (ori - cam_ori).magnitude(), segs + lane))
+                        {
+                            skipped_mask |= (1 << lane);
+                        }
+                        else
+                        {
+                            packet[lane] = geometry::make_dda_ray(ori, dir);
+                            lane_mask |= (1 << lane);
+                        }
+                    }
+                }
+                if (lane_mask != 0)
+                {
+                    geometry::packet_isect(packet, lane_mask, hits, depth_map != nullptr ? segs : nullptr);
+                }
+                for (u32 lane = 0; lane < num_lanes; lane++)
+                {
+                    const u32 i = base + lane;
+                    if ((cached_mask >> lane) & 1)
+                    {
+                        hits[lane] = cached_hits[lane];
+                    }
+                    else if ((skipped_mask >> lane) & 1)
+                    {
+                        hits[lane].hit = false; // No bricks in this pixel
+                        if (hit_cache != nullptr) hit_cache->store(rays->hit_cache_ndx[i], hits[lane], version);
+                    }
+                    else if (!((lane_mask >> lane) & 1))
+                    {
+                        hits[lane].hit = false; // Missed the grid entirely
+                    }
+                    else if (hit_cache != nullptr)
+                    {
+                        hit_cache->store(rays->hit_cache_ndx[i], hits[lane], version);
+                    }
+                    rays->hit[i] = hits[lane].hit;
+                    rays->hit_t[i] = hits[lane].t;
+                    rays->hit_axis[i] = hits[lane].axis;
+                }
+            }
+        }
+        else
+        {
+            // Traverse several bounce rays at once, so their metachunk misses overlap (see [geometry::interleaved_isect])
+#define INTERLEAVE_BOUNCE_RAYS
+#ifdef INTERLEAVE_BOUNCE_RAYS
+            constexpr u32 bounce_interleave = 4; // Best overall factor in [bench::time_interleaving]; wider lanes start thrashing L1 on sparse volumes
+            constexpr u32 batch_size = 64;
+            geometry::dda_ray batch[batch_size];
+            geometry::traversal_hit hits[batch_size];
+            for (u32 base = 0; base < rays->size; base += batch_size)
+            {
+                const u32 n = vmath::min(batch_size, rays->size - base);
+                for (u32 k = 0; k < n; k++)
+                {
+                    const u32 i = base + k;
+                    batch[k] = geometry::make_dda_ray(vmath::vec<3>(rays->ori[0][i], rays->ori[1][i], rays->ori[2][i]),
+                                                      vmath::vec<3>(rays->dir[0][i], rays->dir[1][i], rays->dir[2][i]));
+                }
+                geometry::interleaved_isect<bounce_interleave>(batch, n, hits, true);
+                for (u32 k = 0; k < n; k++)
+                {
+                    const u32 i = base + k;
+                    rays->hit[i] = hits[k].hit;
+                    rays->hit_t[i] = hits[k].t;
+                    rays->hit_axis[i] = hits[k].axis;
+                }
+            }
+#else
+            geometry::traversal_hit hit;
+            for (u32 i = 0; i < rays->size; i++)
+            {
+                const vmath::vec<3> ori(rays->ori[0][i], rays->ori[1][i], rays->ori[2][i]);
+                const vmath::vec<3> dir(rays->dir[0][i], rays->dir[1][i], rays->dir[2][i]);
+                geometry::dda_isect(geometry::make_dda_ray(ori, dir), &hit, true);
+                rays->hit[i] = hit.hit;
+                rays->hit_t[i] = hit.t;
+                rays->hit_axis[i] = hit.axis;
+            }
+#endif
+        }
+    }
+
+    // Shade; scatter paths that hit the grid, resolve escaping paths against the sky, then compact live paths to the front of [rays]
+    // Finished paths move into [splats]
+    void shade(tracing::ray_queue* rays, tracing::splat_queue* splats, u32 tileNdx, path_termination term = path_termination())
+    {
+        const materials::instance& mat = geometry::vol::metadata->mat;
+        u32 num_live = 0;
+        for (u32 i = 0; i < rays->size; i++)
+        {
+            const vmath::vec<3> dir(rays->dir[0][i], rays->dir[1][i], rays->dir[2][i]);
+            bool path_finished = false;
+            if (rays->within_grid[i] && rays->hit[i])
+            {
+                const vmath::vec<3> ori = vmath::vec<3>(rays->ori[0][i], rays->ori[1][i], rays->ori[2][i]) + (dir * rays->hit_t[i]);
+                vmath::vec<3> out_dir;
+                float out_pdf = 0.0f;
+                spectra::lanes out_rho_weight = rays->rho_weight[i];
+                float out_power = rays->power[i];
+                float sample[4]; // Split between BSDF sampling & NEE, same as [isect]
+                switch (mat.material_type)
+                {
+                    case material_labels::DIFFUSE:
+                        parallel::rand_streams[tileNdx].next(sample);
+                        materials::diffuse_surface_sample(&out_dir, &out_pdf, sample[0], sample[1]);
+                        materials::diffuse_lambert_reflection(rays->rho_sample[i], mat.spectral_response, ori, &out_power, &out_rho_weight);
+                        break;
+                    default:
+                        platform::osDebugBreak(); // Unsupported material ;_;
+                        break;
+                }
+
+                // Absorption tests run against the incoming vertex, same as [isect]
+                if (spectra::lanes_max(rays->rho_weight[i]) <= vmath::eps ||
+                    rays->power[i] <= vmath::eps ||
+                    rays->pdf[i] <= vmath::eps)
+                {
+                    path_finished = true;
+                }
+                else
+                {
+                    vmath::vec<3> voxel_normal = vmath::vec<3>(0.0f);
+                    voxel_normal.e[rays->hit_axis[i]] = dir.e[rays->hit_axis[i]] >= 0.0f ? -1.0f : 1.0f;
+                    out_dir = vmath::normalSpace(voxel_normal).apply(out_dir).normalized();
+#ifdef SKY_NEE
+                    if (rays->path_pdf[i] > 0.0f)
+                    {
+                        rays->nee[i] += sky_nee(ori, voxel_normal, dir, rays->num_vts[i] == 0, (rays->num_vts[i] + 1u) >= term.max_bounces, rays->rho_sample[i],
+                                                (rays->path_response[i] * rays->path_power[i]) / rays->path_pdf[i], out_rho_weight, out_power, sample[2], sample[3]);
+                    }
+#endif
+                    rays->append_vt(i, out_dir, out_pdf, out_rho_weight, out_power);
+
+                    // Roulette/bounce limits, same as [isect]
+                    float survival = 1.0f;
+                    const float throughput = rays->path_pdf[i] > 0.0f ? (spectra::lanes_mean(rays->path_response[i]) * rays->path_power[i]) / rays->path_pdf[i] : 0.0f;
+                    if (!continue_path(term, rays->num_vts[i], throughput, tileNdx, &survival))
+                    {
+                        rays->path_power[i] = 0.0f;
+                        path_finished = true;
+                    }
+                    rays->path_pdf[i] *= survival;
+                    for (u8 j = 0; j < 3; j++)
+                    {
+                        rays->ori[j][i] = ori.e[j];
+                        rays->dir[j][i] = out_dir.e[j];
+                    }
+                    rays->pdf[i] = out_pdf;
+                    rays->rho_weight[i] = out_rho_weight;
+                    rays->power[i] = out_power;
+                }
+                if (path_finished) record_path_length(tileNdx, rays->num_vts[i]);
+            }
+            else
+            {
+                // Paths missing the grid (or leaving it) escape into the sky
+                float sky_pdf = 0.0f;
+                float sky_power = rays->power[i] * lights::sky_env(&sky_pdf);
+#ifdef SKY_NEE
+                if (rays->num_vts[i] > 0)
+                {
+                    sky_power *= sky_bsdf_weight(rays->rho_sample[i].e[0], dir, rays->pdf[i]); // Scattered paths carry their BSDF pdf in [pdf]
+                }
+#endif
+                record_path_length(tileNdx, rays->num_vts[i]); // Sky vertices aren't scattering events
+                rays->append_vt(i, dir, sky_pdf, spectra::sky(rays->rho_sample[i], dir.e[1]), sky_power);
+                path_finished = true;
+            }
+
+            // Compact
+            if (path_finished)
+            {
+                splats->push(*rays, i);
+            }
+            else
+            {
+                if (num_live != i)
+                {
+                    rays->move(num_live, i);
+                }
+                num_live++;
+            }
+        }
+        rays->size = num_live;
     }
 };
 #ifdef SCN_DBG
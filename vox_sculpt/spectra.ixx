@@ -4,6 +4,59 @@ import vmath;
 
 export namespace spectra
 {
+    // Hero-wavelength sampling (Wilkie et al. 2014, "Hero Wavelength Spectral Sampling")
+    // Every path carries four wavelengths through one shared geometric path; the first (the hero) is drawn uniformly over the spectrum, and
+    // the others are spaced evenly around the (wrapped) spectrum from it, so the four lanes stratify the spectrum between them. Traversal is
+    // paid once for all four, so colour noise per ray drops roughly by the lane count
+    // Rotating a uniform hero leaves every lane uniform as well, which is what lets [film] weight lanes equally; heroes drawn from any other
+    // density (e.g. the importance-driven [spectral_buckets]) would need spectral MIS weights (1 / sum of the lane densities) per lane, so
+    // bucket importance only drives single-wavelength paths
+    // Anything that picks directions (light sampling, MIS, roulette) works from the hero alone or from lane averages; every lane sees the same
+    // directional densities, so those choices don't bias one wavelength against another
+    // With the switch off, lanes past the hero still trace (as copies of the hero) but never reach the film
+#define HERO_WAVELENGTHS
+#ifdef HERO_WAVELENGTHS
+    constexpr bool hero_wavelengths_enabled = true;
+    constexpr u32 num_wavelengths = 4;
+#else
+    constexpr bool hero_wavelengths_enabled = false;
+    constexpr u32 num_wavelengths = 1;
+#endif
+    typedef vmath::vec<4> lanes; // One wavelength (or one per-wavelength weight) per element; the hero sits in [e[0]]
+
+    // Wavelengths for a path with hero wavelength [hero]; [hero] should be uniform over [0...1) whenever hero wavelengths are enabled
+    lanes hero_wavelengths(float hero)
+    {
+        lanes rho;
+        for (u32 i = 0; i < 4; i++)
+        {
+            const float offs = hero + (static_cast<float>(i) / num_wavelengths);
+            rho.e[i] = offs - vmath::ffloor(offs);
+        }
+        return rho;
+    }
+
+    // Mean & max weights over the lanes that reach the film
+    float lanes_mean(lanes weights)
+    {
+        float sum = 0.0f;
+        for (u32 i = 0; i < num_wavelengths; i++)
+        {
+            sum += weights.e[i];
+        }
+        return sum / num_wavelengths;
+    }
+
+    float lanes_max(lanes weights)
+    {
+        float m = weights.e[0];
+        for (u32 i = 1; i < num_wavelengths; i++)
+        {
+            m = vmath::max(m, weights.e[i]);
+        }
+        return m;
+    }
+
     // Super basic sky model - sharp blue fading to orange as y approaches zero
     // Desmos visualization
     // https://www.desmos.com/calculator/7qqnkr1uqx
@@ -14,6 +67,11 @@ export namespace spectra
         return vmath::lerp(blue, orange, vmath::fabs(y));
     }
 
+    lanes sky(lanes rho, float y)
+    {
+        return lanes(sky(rho.e[0], y), sky(rho.e[1], y), sky(rho.e[2], y), sky(rho.e[3], y));
+    }
+
     // Custom film/sensor response curve, kinda follows the references in Zucconi's diffraction tutorial but heavily iterated to give a more film-like
     // spectrum; Zucconi's tutorial is here
     // https://www.alanzucconi.com/2017/07/15/improving-the-rainbow/,
@@ -29,6 +87,19 @@ export namespace spectra
                                          vmath::quadratic(rho, 1.0f, 0.95f, 0.0f, false) + 0.1f, 0.0f));
     }
 
+    // Film response for a full set of lanes, each scaled by its spectral weight; averaged so that colours stay on the same scale with
+    // hero-wavelength sampling enabled or disabled
+    // Equal lane weights are only valid for uniform heroes (see [hero_wavelengths])
+    vmath::vec<3> film(lanes rho, lanes weights)
+    {
+        vmath::vec<3> rgb = film(rho.e[0]) * weights.e[0];
+        for (u32 i = 1; i < num_wavelengths; i++)
+        {
+            rgb += film(rho.e[i]) * weights.e[i];
+        }
+        return rgb / static_cast<float>(num_wavelengths);
+    }
+
     // Generic diffuse surface colors until I get imgui working
     const float placeholder_spd(vmath::vec<4> coords_and_rho) // [xyz], w (wavelength)
     {
@@ -65,7 +136,7 @@ export namespace spectra
 
             // The surface is matte black; all frequencies reflected equally poorly
             // Since no frequencies are particularly bright, just return one at random
-            last_bucket = static_cast<u32>(vmath::ffloor(u * num_buckets));
+            last_bucket = vmath::min(static_cast<u32>(vmath::ffloor(u * num_buckets)), num_buckets - 1); // [u] can round up to exactly 1
             return (last_bucket * interval_size) + (v * interval_size);
         }
         void update(float weight)
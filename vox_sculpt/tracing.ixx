@@ -14,6 +14,7 @@ import spectra;
 import sampler;
 import lights;
 import aa;
+import denoise;
 
 //#define TRACING_DBG
 #ifdef TRACING_DBG
@@ -22,10 +23,58 @@ import aa;
 
 namespace tracing
 {
+    // Bidirectional previews are compiled out by default; on the cavity test scene they match unidirectional error at equal spp (RMSE
+    // 342.46 vs 342.45 at 15spp), but cost ~3x as much per sample, so they lose at equal time (372 at 5spp vs 342 at 15spp). Most of
+    // our noise comes from spectral & first-bounce sampling, which the extra strategies don't touch. Requests for the bidirectional
+    // mode fall back to [RENDER_MODE_FINAL_PREVIEW] without the switch below
+//#define BIDIRECTIONAL_PREVIEW
+#ifdef BIDIRECTIONAL_PREVIEW
+    constexpr bool bidirectional_preview_enabled = true;
+#else
+    constexpr bool bidirectional_preview_enabled = false;
+#endif
+
+#ifdef BIDIRECTIONAL_PREVIEW
     export path* cameraPaths; // One reusable path/tile for now, minx * miny expected for VCM
                               // (so we can process each one multiple times against arbitrary light paths)
-    //path* lightPaths;
+                              // Only needed for bidirectional integration; unidirectional paths stream through [path_accumulator]
+    path* lightPaths; // One reusable light path/tile, for the same reasons
+#endif
     export float* isosurf_distances; // Distances to sculpture boundaries from grid bounds, per-subpixel, refreshed on camera zoom/rotate + animation timesteps (if/when I decide to implement those)
+    geometry::primary_hit_cache primary_hits; // Full primary traversal results per-subpixel on the [aa] grid; versioned against view/volume updates, so never cleared after init
+    geometry::brick_depth_map brick_depths; // Per-pixel depth ranges covered by occupied coarse bricks; refreshed by [brick_depth_prepass], versioned like [primary_hits]
+
+    // Per-tile volume coverage; one bit per-pixel (tile-local scanline order), set wherever at least one occupied coarse brick projects
+    // into the pixel
+    // Refreshed alongside [brick_depths], and only trusted while the version & bounds match the current view/tile; sky-only pixels skip
+    // geometry entirely, and tiles without any coverage never set up traversal
+    struct tile_coverage
+    {
+        u64* bits = nullptr;
+        u32 version = 0;
+        i32 min_x = 0;
+        i32 min_y = 0;
+        i32 width = 0;
+        i32 height = 0;
+        u32 num_covered = 0;
+
+        bool valid(i32 minX, i32 xMax, i32 minY, i32 yMax) const
+        {
+            return valid_at(geometry::vol::scene_version(), minX, xMax, minY, yMax);
+        }
+        bool valid_at(u32 scene_version, i32 minX, i32 xMax, i32 minY, i32 yMax) const
+        {
+            return version == scene_version &&
+                   min_x == minX && min_y == minY && width == (xMax - minX) && height == (yMax - minY);
+        }
+        bool covered(i32 x, i32 y) const
+        {
+            const u32 local = static_cast<u32>((x - min_x) + (y - min_y) * width);
+            return (bits[local >> 6] >> (local & 63)) & 1;
+        }
+    };
+    tile_coverage* coverage = nullptr;
+    u32 coverage_words_per_tile = 0; // Sized for the largest tile [trace] can produce (full-window tiles; volume tiles are never larger)
     u32* sample_ctr = nullptr;
     export vmath::vec<2>* tracing_tile_positions = nullptr;
     export vmath::vec<2>* tracing_tile_bounds = nullptr;
@@ -48,6 +97,8 @@ namespace tracing
     {
         RENDER_MODE_EDIT,
         RENDER_MODE_FINAL_PREVIEW,
+        RENDER_MODE_BIDIRECTIONAL_PREVIEW, // Final preview with bidirectional path tracing instead of the unidirectional integrators
+                                           // (see [scene::bdpt_path_value]); kept for comparison work, see [bidirectional_preview_enabled]
         RENDER_MODE_FINAL_TO_FILE
         // RENDER_MODE_PAINTING
         // RENDER_MODE_SCULPTING
@@ -58,15 +109,134 @@ namespace tracing
     RENDER_MODES renderMode = RENDER_MODE_EDIT; // Edit mode by default
     export void set_render_mode(RENDER_MODES mode)
     {
-        renderMode = mode;
+        renderMode = (mode == RENDER_MODE_BIDIRECTIONAL_PREVIEW && !bidirectional_preview_enabled) ? RENDER_MODE_FINAL_PREVIEW : mode;
     }
 
+    // Path termination per render mode (see [scene::path_termination]); edit mode keeps paths short so sculpting stays responsive,
+    // final renders allow much longer paths before cutting them off
+    constexpr scene::path_termination render_mode_termination[4] =
+    {
+        { 2, 4 }, // RENDER_MODE_EDIT
+        { 3, 32 }, // RENDER_MODE_FINAL_PREVIEW
+        scene::bdpt_termination, // RENDER_MODE_BIDIRECTIONAL_PREVIEW
+        { 3, 64 } // RENDER_MODE_FINAL_TO_FILE
+    };
+
+    // Integration strategies available in every render mode
+    // The recursive integrator traces each path to completion before moving on to the next pixel; the wavefront integrator
+    // queues camera rays per-tile and runs each stage (generate/extend/shade/splat) over the whole queue at once, compacting
+    // live paths between bounces
+    export enum INTEGRATORS
+    {
+        INTEGRATOR_RECURSIVE,
+        INTEGRATOR_WAVEFRONT
+    };
+
+    // Set the integrator to use in the next "frame"
+    INTEGRATORS integrator = INTEGRATOR_WAVEFRONT;
+    export void set_integrator(INTEGRATORS i)
+    {
+        integrator = i;
+    }
+
+    // Per-tile wavefront queues
+    ray_queue* wavefront_rays = nullptr;
+    splat_queue* wavefront_splats = nullptr;
+
+    // Adaptive sampling for final renders
+    // Every pixel takes [adaptive_min_samples] samples before we trust any error estimates; after that, each pass only revisits
+    // blocks whose relative error is above [adaptive_focus] times their tile's average (and still above [adaptive_target_error]).
+    // Tiles retire once their average error meets the target, or every pixel runs out of samples
+    // Errors are estimated per-block rather than per-pixel; single pixels don't take enough samples for their variance estimates
+    // to be reliable, and letting each pixel decide for itself biases the image towards whichever samples happened to look converged
+    // Sky prepasses always take [aa::max_samples] uniform passes
+    // Off by default; on the cavity test scene, adaptive passes reach the same worst-block error ~1.4x sooner on crops mixing sky and
+    // sculpture, but mean relative MSE at equal time is worse (noisy pixels are also the expensive ones, and block errors don't weigh
+    // per-pixel cost), and cavity-only crops take ~8% longer for the same error as uniform 64spp
+//#define ADAPTIVE_SAMPLING
+#ifdef ADAPTIVE_SAMPLING
+    constexpr bool adaptive_sampling_enabled = true;
+#else
+    constexpr bool adaptive_sampling_enabled = false;
+#endif
+    constexpr u32 adaptive_min_samples = 8;
+    constexpr u32 adaptive_max_samples = aa::max_samples * 4;
+    constexpr float adaptive_target_error = 0.3f;
+    constexpr float adaptive_focus = 1.0f;
+    constexpr float adaptive_luma_floor = 0.1f; // Blocks dimmer than this fraction of their tile's average luminance are measured
+                                                // against absolute (rather than relative) error
+    constexpr u32 adaptive_block_size = 8;
+    struct adaptive_tile_state
+    {
+        float mean_error; // Average relative error over the tile's unfinished blocks
+        float* block_errors; // Relative error per-block, rows of [adaptive_block_size]x[adaptive_block_size] blocks from the tile's top-left corner
+    };
+    adaptive_tile_state* adaptive_tiles = nullptr; // Refreshed after every adaptive pass
+    u32 adaptive_blocks_per_tile = 0; // Sized for the largest tile [trace] can produce, like [coverage_words_per_tile]
+
+    // Temporal reprojection for EDIT mode
+    // Spins & zooms used to restart EDIT tiles from black; instead, we remember the surface behind each pixel (from its cached primary
+    // hits, in voxel space), move those surfaces into the new view, and seed whichever pixels they land on with the old sensor values
+    // Surfaces need to stay front-facing and inside the new view's brick depth spans, and the nearest surface landing in each pixel
+    // wins (surfaces close behind it merge in); disocclusions, silhouettes and surfaces crossing into other tiles restart from scratch
+    // Moved surfaces count for [reprojection_history_weight] of their old samples, since shading shifts with the view; sky pixels
+    // keep their samples, since the camera itself never moves
+#define TEMPORAL_REPROJECTION
+#ifdef TEMPORAL_REPROJECTION
+    constexpr bool temporal_reprojection_enabled = true;
+#else
+    constexpr bool temporal_reprojection_enabled = false;
+#endif
+    constexpr float reprojection_history_weight = 0.75f;
+    constexpr float reprojection_depth_tolerance = 2.0f; // In pixel footprints; cached hits spreading further than this mark silhouettes,
+                                                         // and surfaces landing this close behind the nearest one merge into it
+    enum REPROJECTION_SURFACES : u8
+    {
+        REPROJECTION_NONE,
+        REPROJECTION_SKY,
+        REPROJECTION_VOXELS
+    };
+    struct reprojection_surface
+    {
+        vmath::vec<3> voxel; // Average of the pixel's cached hits, in voxel space
+        u8 type; // One of [REPROJECTION_SURFACES]
+        u8 axis; // Normal axis
+        i8 facing; // Normal sign along [axis]
+    };
+    reprojection_surface* reprojection_surfaces = nullptr; // Per-pixel; carried along with reprojected sensors, so history can keep moving
+                                                          // through several views before its pixels are traced again
+    constexpr u32 reprojection_no_target = 0xffffffff;
+    struct reprojection_source
+    {
+        reprojection_surface surface;
+        u32 target; // Pixel [surface] lands on in the new view, or [reprojection_no_target]
+        float depth; // Distance from the camera to [surface] in the new view
+    };
+    reprojection_source* reprojection_sources = nullptr; // Per-pixel scratch
+    float* reprojection_depths = nullptr; // Per-pixel; nearest depth reprojected into each pixel
+    struct reprojection_view
+    {
+        u32 version = 0; // [geometry::vol::scene_version()] at the start of the tile's latest EDIT pass; matches hits cached by that pass
+        u32 volume_version = 0;
+        geometry::vol::view_transform view;
+        bool recorded = false;
+    };
+    reprojection_view* reprojection_views = nullptr; // Per-tile
+
     // Clear render state (needed for render mode transitions + refreshing before each EDIT pass)
     void clear_render_state(u32 tileNdx, i32 minX, i32 xMax, i32 minY, i32 yMax)
     {
         sample_ctr[tileNdx] = 0;
+        adaptive_tiles[tileNdx].mean_error = 1.0f;
         camera::clear_patch(minX, xMax, minY, yMax);
-        platform::osClearMem(cameraPaths + tileNdx, sizeof(path));
+#ifdef BIDIRECTIONAL_PREVIEW
+        cameraPaths[tileNdx].clear(); // Vertices are always written before they're read, so there's no need to touch the whole buffer
+        lightPaths[tileNdx].clear();
+#endif
+        if constexpr (scene::path_length_stats_enabled)
+        {
+            platform::osClearMem(scene::path_length_histograms + (tileNdx * scene::path_length_bins), sizeof(u64) * scene::path_length_bins);
+        }
         const u32 w = xMax - minX;
         for (i32 y = minY; y < yMax; y++)
         {
@@ -74,17 +244,599 @@ namespace tracing
             const u32 offs = minX + yOffs;
             *(isosurf_distances + offs) = -1.0f;
             platform::osClearMem(spectral_strata + offs, sizeof(spectra::spectral_buckets) * w);
+            if constexpr (temporal_reprojection_enabled)
+            {
+                platform::osClearMem(reprojection_surfaces + offs, sizeof(reprojection_surface) * w);
+            }
+        }
+    }
+
+    // Denoised EDIT previews leave [camera::digital_colors] to [denoise::filter_tile]; tonemapping samples as they land would overwrite
+    // filtered pixels with raw ones between filter passes, so the preview would flicker between denoised and noisy frames
+    bool denoised_preview()
+    {
+        return denoise::enabled && renderMode == RENDER_MODE_EDIT;
+    }
+
+    // Compute sensor response + apply sample weight (composite of integration weight for spectral accumulation,
+    // lens-sampled filter weight for AA, and path index weights from ray propagation)
+    void resolve_sample(spectra::lanes rho, spectra::lanes rho_weight, float pdf, float power, u32 pixel_ndx, u32 tileNdx, spectra::lanes direct = 0.0f)
+    {
+        // The first pass in each tile resets its sensors; later passes count samples per-pixel, since adaptive passes
+        // skip pixels that have already converged (and EDIT passes skip pixels depending on their stride)
+        // EDIT sensors are cleared (or seeded with reprojected history) before their first pass, so they always count on
+        if (adaptive_sampling_enabled || renderMode == RENDER_MODE_EDIT)
+        {
+            const bool first_pass = (sample_ctr[tileNdx] == 1) && (renderMode != RENDER_MODE_EDIT);
+            const u32 sample_num = first_pass ? 1 : camera::sensor_samples(pixel_ndx) + 1;
+            const u32 sample_cap = (renderMode == RENDER_MODE_EDIT) ? aa::max_samples + 1 : adaptive_max_samples + 1;
+            camera::sensor_response(rho, rho_weight, pdf, power, pixel_ndx, sample_num, sample_cap, direct);
+        }
+        else
+        {
+            camera::sensor_response(rho, rho_weight, pdf, power, pixel_ndx, sample_ctr[tileNdx], aa::max_samples, direct);
+        }
+
+        // Map resolved sensor responses back into tonemapped RGB values we can store for output
+        if (!denoised_preview())
+        {
+            camera::tonemap_out(pixel_ndx);
+        }
+
+        // Update weight for the bucket containing the current spectral sample (single-wavelength paths only, see [spectra::hero_wavelengths])
+        if constexpr (!spectra::hero_wavelengths_enabled)
+        {
+            spectral_strata[pixel_ndx].update(rho_weight.e[0]);
+        }
+    }
+
+    // Project every occupied coarse brick over the given tile, and record the range of camera distances each pixel could hit bricks
+    // at (see [geometry::brick_depth_map])
+    // Rects are padded by a pixel on each side to cover lens jitter, and bricks reaching behind the camera cover the whole tile
+    // Also refreshes the coverage mask for [tileNdx]
+    void brick_depth_prepass(u32 tileNdx, i32 minX, i32 xMax, i32 minY, i32 yMax)
+    {
+        const u32 version = geometry::vol::scene_version(); // Read before the view, so spins/zooms during the prepass leave spans stale rather than mismatched
+        const geometry::vol::view_transform view = geometry::vol::view;
+        for (i32 y = minY; y < yMax; y++)
+        {
+            for (i32 x = minX; x < xMax; x++)
+            {
+                brick_depths.reset(y * ui::window_width + x, version);
+            }
+        }
+
+        const vmath::vec<3> cam = camera::camera_pos();
+        for (u32 i = 0; i < geometry::vol::num_occupied_coarse_bricks; i++)
+        {
+            vmath::vec<3> bounds[2];
+            geometry::brick_depth_map::brick_bounds(geometry::vol::occupied_coarse_bricks[i], view, bounds, bounds + 1);
+
+            // Nearest point on the brick (zero when the camera is inside it), farthest corner, and screen-space extents
+            const float entry = (vmath::clamp(cam, bounds[0], bounds[1]) - cam).magnitude();
+            float exit = 0.0f;
+            float px_min[2] = { 9999999.0f, 9999999.0f };
+            float px_max[2] = { -9999999.0f, -9999999.0f };
+            bool projectable = true;
+            for (u32 c = 0; c < 8; c++)
+            {
+                const vmath::vec<3> corner(bounds[c & 1].x(), bounds[(c >> 1) & 1].y(), bounds[c >> 2].z());
+                exit = vmath::max(exit, (corner - cam).magnitude());
+                bool in_front;
+                const vmath::vec<2> px = camera::project_to_film(corner, &in_front);
+                projectable = projectable && in_front;
+                for (u8 j = 0; j < 2; j++)
+                {
+                    px_min[j] = vmath::min(px_min[j], px.e[j]);
+                    px_max[j] = vmath::max(px_max[j], px.e[j]);
+                }
+            }
+
+            // Clip to the tile
+            i32 x0 = minX, x1 = xMax, y0 = minY, y1 = yMax;
+            if (projectable)
+            {
+                if (px_max[0] < minX - 1 || px_min[0] > xMax + 1 ||
+                    px_max[1] < minY - 1 || px_min[1] > yMax + 1) continue;
+                x0 = vmath::max(static_cast<i32>(vmath::ffloor(px_min[0])) - 1, x0);
+                x1 = vmath::min(static_cast<i32>(vmath::fceil(px_max[0])) + 2, x1);
+                y0 = vmath::max(static_cast<i32>(vmath::ffloor(px_min[1])) - 1, y0);
+                y1 = vmath::min(static_cast<i32>(vmath::fceil(px_max[1])) + 2, y1);
+            }
+            for (i32 y = y0; y < y1; y++)
+            {
+                for (i32 x = x0; x < x1; x++)
+                {
+                    brick_depths.include(y * ui::window_width + x, entry, exit);
+                }
+            }
+        }
+
+        // Pack coverage bits for the tile
+        tile_coverage& cov = coverage[tileNdx];
+        cov.min_x = minX;
+        cov.min_y = minY;
+        cov.width = xMax - minX;
+        cov.height = yMax - minY;
+        cov.num_covered = 0;
+        if (static_cast<u32>(cov.width * cov.height) > coverage_words_per_tile * 64)
+        {
+            cov.version = 0; // Shouldn't happen; treat every pixel as covered instead of overrunning the mask
+            return;
+        }
+        platform::osClearMem(cov.bits, sizeof(u64) * coverage_words_per_tile);
+        for (i32 y = minY; y < yMax; y++)
+        {
+            for (i32 x = minX; x < xMax; x++)
+            {
+                if (brick_depths.covered(y * ui::window_width + x))
+                {
+                    const u32 local = static_cast<u32>((x - minX) + (y - minY) * cov.width);
+                    cov.bits[local >> 6] |= 1ull << (local & 63);
+                    cov.num_covered++;
+                }
+            }
+        }
+        cov.version = version;
+    }
+
+    // Remember the view each EDIT pass traces against, so [gather_reprojection_sources] can read back that pass's primary hits after
+    // a spin/zoom
+    void record_reprojection_view(u32 tileNdx)
+    {
+        reprojection_view& rv = reprojection_views[tileNdx];
+        rv.version = geometry::vol::scene_version(); // Read before the view, same as [brick_depth_prepass]
+        rv.volume_version = static_cast<u32>(geometry::vol::volume_version->load());
+        rv.view = geometry::vol::view;
+        rv.recorded = true;
+    }
+
+    // Worldspace width of one pixel, [dist] away from the camera
+    float pixel_footprint(float dist)
+    {
+        return dist * aa::samples_x / camera::camera_z_axis();
+    }
+
+    // Resolve the surface behind every sampled pixel in the given tile and snapshot its sensors, before the tile's render state is cleared
+    // Pixels traced in the recorded view use their cached primary hits (or their coverage, for sky-only pixels); pixels only holding
+    // reprojected history reuse the surfaces they were seeded with
+    // Returns false when there's nothing to reproject (no recorded view, or the volume itself changed)
+    bool gather_reprojection_sources(u32 tileNdx, i32 minX, i32 xMax, i32 minY, i32 yMax)
+    {
+        const reprojection_view& rv = reprojection_views[tileNdx];
+        if (!rv.recorded || rv.volume_version != static_cast<u32>(geometry::vol::volume_version->load())) return false;
+        camera::store_history(minX, xMax, minY, yMax);
+
+        const tile_coverage& cov = coverage[tileNdx];
+        const bool coverage_recorded = cov.valid_at(rv.version, minX, xMax, minY, yMax);
+        const vmath::vec<3> cam = camera::camera_pos();
+        const float spread_tolerance = reprojection_depth_tolerance * pixel_footprint(1.0f); // Per unit distance
+        for (i32 y = minY; y < yMax; y++)
+        {
+            for (i32 x = minX; x < xMax; x++)
+            {
+                const u32 pixel_ndx = y * ui::window_width + x;
+                reprojection_surface& s = reprojection_sources[pixel_ndx].surface;
+                s = reprojection_surfaces[pixel_ndx];
+                if (camera::sensor_samples(pixel_ndx) == 0)
+                {
+                    s.type = REPROJECTION_NONE;
+                    continue;
+                }
+                if (coverage_recorded && !cov.covered(x, y))
+                {
+                    s.type = REPROJECTION_SKY;
+                    continue;
+                }
+
+                u32 num_hits = 0, num_misses = 0;
+                u32 axis_counts[3] = { 0, 0, 0 };
+                vmath::vec<3> voxel_sum(0.0f);
+                float dist_min = geometry::dda_unbounded, dist_max = 0.0f;
+                for (u32 i = 0; i < aa::max_samples; i++)
+                {
+                    geometry::traversal_hit hit;
+                    if (!primary_hits.lookup_version(pixel_ndx * aa::max_samples + i, rv.version, &hit)) continue;
+                    if (!hit.hit)
+                    {
+                        num_misses++;
+                        continue;
+                    }
+                    const vmath::vec<3> voxel = vmath::vec<3>(static_cast<float>(hit.voxel.x()), static_cast<float>(hit.voxel.y()), static_cast<float>(hit.voxel.z())) +
+                                                vmath::vec<3>(0.5f);
+                    const float dist = (rv.view.voxel_to_world(voxel) - cam).magnitude();
+                    dist_min = vmath::min(dist_min, dist);
+                    dist_max = vmath::max(dist_max, dist);
+                    voxel_sum += voxel;
+                    axis_counts[hit.axis]++;
+                    num_hits++;
+                }
+                if ((num_hits + num_misses) == 0) continue; // Not traced in the recorded view, keep the carried surface
+                if (num_hits == 0)
+                {
+                    s.type = REPROJECTION_SKY; // Crossed the grid without touching anything
+                    continue;
+                }
+                if (num_misses > 0 || (dist_max - dist_min) > (spread_tolerance * dist_min))
+                {
+                    s.type = REPROJECTION_NONE; // Silhouettes mix surfaces that won't move together
+                    continue;
+                }
+                s.type = REPROJECTION_VOXELS;
+                s.voxel = voxel_sum / static_cast<float>(num_hits);
+                s.axis = (axis_counts[0] >= axis_counts[1]) ? ((axis_counts[0] >= axis_counts[2]) ? 0 : 2) :
+                                                             ((axis_counts[1] >= axis_counts[2]) ? 1 : 2);
+                const vmath::vec<3> dir = rv.view.voxel_to_world(s.voxel) - cam;
+                s.facing = (dir.e[s.axis] > 0.0f) ? -1 : 1; // Hit faces point back along the rays that found them (voxel axes keep their
+                                                           // worldspace signs, see [view_transform::voxel_to_world])
+            }
+        }
+        return true;
+    }
+
+    // Seed a freshly-cleared tile with the surfaces from [gather_reprojection_sources], moved into the current view
+    // Expects brick depths to be refreshed for the current view first
+    void reproject_tile_history(u32 tileNdx, i32 minX, i32 xMax, i32 minY, i32 yMax)
+    {
+        const geometry::vol::view_transform view = geometry::vol::view;
+        const vmath::vec<3> cam = camera::camera_pos();
+        const float merge_tolerance = reprojection_depth_tolerance * pixel_footprint(1.0f); // Per unit distance
+        for (i32 y = minY; y < yMax; y++)
+        {
+            for (i32 x = minX; x < xMax; x++)
+            {
+                reprojection_depths[y * ui::window_width + x] = geometry::dda_unbounded;
+            }
+        }
+
+        // Project each surface, and keep the nearest depth landing in each pixel
+        for (i32 y = minY; y < yMax; y++)
+        {
+            for (i32 x = minX; x < xMax; x++)
+            {
+                const u32 pixel_ndx = y * ui::window_width + x;
+                reprojection_source& src = reprojection_sources[pixel_ndx];
+                src.target = reprojection_no_target;
+                if (src.surface.type == REPROJECTION_SKY)
+                {
+                    if (!brick_depths.covered(pixel_ndx)) // Sky stays sky unless the volume moved in front of it
+                    {
+                        src.target = pixel_ndx;
+                        src.depth = geometry::dda_unbounded;
+                    }
+                    continue;
+                }
+                if (src.surface.type != REPROJECTION_VOXELS) continue;
+
+                const vmath::vec<3> world = view.voxel_to_world(src.surface.voxel);
+                const vmath::vec<3> rel = world - cam;
+                if ((rel.e[src.surface.axis] * src.surface.facing) >= 0.0f) continue; // Turned away from the camera
+
+                bool in_front;
+                const vmath::vec<2> film = camera::project_to_film(world, &in_front);
+                if (!in_front) continue;
+                const i32 tx = static_cast<i32>(vmath::ffloor(film.x() + 0.5f));
+                const i32 ty = static_cast<i32>(vmath::ffloor(film.y() + 0.5f));
+                if (tx < minX || tx >= xMax || ty < minY || ty >= yMax) continue; // Other tiles might already be tracing their new views
+
+                const u32 target = ty * ui::window_width + tx;
+                const float depth = rel.magnitude();
+                if (!brick_depths.contains(target, depth)) continue; // No bricks there anymore (or the view changed again mid-update)
+                src.target = target;
+                src.depth = depth;
+                reprojection_depths[target] = vmath::min(reprojection_depths[target], depth);
+            }
+        }
+
+        // Merge surfaces near the front of each pixel into its sensor; the nearest one also becomes the pixel's surface for later
+        // reprojections
+        for (i32 y = minY; y < yMax; y++)
+        {
+            for (i32 x = minX; x < xMax; x++)
+            {
+                const u32 pixel_ndx = y * ui::window_width + x;
+                const reprojection_source& src = reprojection_sources[pixel_ndx];
+                if (src.target == reprojection_no_target) continue;
+                const float front = reprojection_depths[src.target];
+                if (src.depth > (front * (1.0f + merge_tolerance))) continue; // Occluded
+
+                const bool sky = src.surface.type == REPROJECTION_SKY;
+                camera::reproject_sensor(pixel_ndx, src.target, sky ? 1.0f : reprojection_history_weight,
+                                         sky ? aa::max_samples : static_cast<u32>(aa::max_samples * reprojection_history_weight)); // Moved surfaces
+                                                                                                                                // always leave room for new samples
+                if (src.depth <= front)
+                {
+                    reprojection_surfaces[src.target] = src.surface;
+                }
+            }
+        }
+        for (i32 y = minY; y < yMax; y++)
+        {
+            for (i32 x = minX; x < xMax; x++)
+            {
+                const u32 pixel_ndx = y * ui::window_width + x;
+                if (camera::sensor_samples(pixel_ndx) > 0 && !denoised_preview())
+                {
+                    camera::tonemap_out(pixel_ndx);
+                }
+            }
+        }
+    }
+
+    // Resolve denoising guides for the given tile from the current view's cached primary hits (see [denoise::set_guide]); pixels only
+    // holding reprojected history fall back on the surfaces they were seeded with
+    void resolve_denoise_guides(i32 minX, i32 xMax, i32 minY, i32 yMax)
+    {
+        const geometry::vol::view_transform view = geometry::vol::view;
+        const vmath::vec<3> cam = camera::camera_pos();
+        for (i32 y = minY; y < yMax; y++)
+        {
+            for (i32 x = minX; x < xMax; x++)
+            {
+                const u32 pixel_ndx = y * ui::window_width + x;
+                if (camera::sensor_samples(pixel_ndx) == 0)
+                {
+                    denoise::set_sky_guide(pixel_ndx); // Holes are filled after filtering, without guides
+                    continue;
+                }
+
+                u32 num_hits = 0;
+                u32 axis_counts[3] = { 0, 0, 0 };
+                vmath::vec<3> voxel_sum(0.0f);
+                for (u32 i = 0; i < aa::max_samples; i++)
+                {
+                    geometry::traversal_hit hit;
+                    if (!primary_hits.lookup(pixel_ndx * aa::max_samples + i, &hit) || !hit.hit) continue;
+                    voxel_sum += vmath::vec<3>(static_cast<float>(hit.voxel.x()), static_cast<float>(hit.voxel.y()), static_cast<float>(hit.voxel.z())) +
+                                 vmath::vec<3>(0.5f);
+                    axis_counts[hit.axis]++;
+                    num_hits++;
+                }
+
+                vmath::vec<3> voxel;
+                u8 axis;
+                if (num_hits > 0)
+                {
+                    voxel = voxel_sum / static_cast<float>(num_hits);
+                    axis = (axis_counts[0] >= axis_counts[1]) ? ((axis_counts[0] >= axis_counts[2]) ? 0 : 2) :
+                                                               ((axis_counts[1] >= axis_counts[2]) ? 1 : 2);
+                }
+                else if (temporal_reprojection_enabled && reprojection_surfaces[pixel_ndx].type == REPROJECTION_VOXELS)
+                {
+                    voxel = reprojection_surfaces[pixel_ndx].voxel;
+                    axis = reprojection_surfaces[pixel_ndx].axis;
+                }
+                else
+                {
+                    denoise::set_sky_guide(pixel_ndx);
+                    continue;
+                }
+                const vmath::vec<3> dir = view.voxel_to_world(voxel) - cam;
+                vmath::vec<3> normal(0.0f);
+                normal.e[axis] = (dir.e[axis] > 0.0f) ? -1.0f : 1.0f; // Same facing as [gather_reprojection_sources]
+                denoise::set_guide(pixel_ndx, dir.magnitude(), normal);
+            }
+        }
+    }
+
+    // Camera rays queued for packet traversal
+    struct primary_packet
+    {
+        path_vt cam_vts[geometry::packet_width];
+        u32 pixel_ndces[geometry::packet_width];
+        u32 cache_ndces[geometry::packet_width];
+        u8 size = 0;
+    };
+
+    // Traverse a packet of primary rays together, then scatter each path through the scene individually
+    void trace_primary_packet(primary_packet* packet, u32 tileNdx)
+    {
+        // Move rays onto the grid, then traverse every ray that touched it (unless its subpixel already has a cached hit)
+        // Rays through pixels without any bricks resolve as misses without traversal; everything else only walks the depth range
+        // covered by bricks in its pixel
+        geometry::dda_ray rays[geometry::packet_width];
+        geometry::dda_segment segs[geometry::packet_width];
+        geometry::traversal_hit hits[geometry::packet_width];
+        geometry::traversal_hit cached_hits[geometry::packet_width];
+        u8 lane_mask = 0;
+        u8 cached_mask = 0;
+        u8 skipped_mask = 0;
+        const u32 version = primary_hits.current_version(); // Read before the view, same as [brick_depth_prepass]
+        for (u8 i = 0; i < packet->size; i++)
+        {
+            vmath::vec<3> grid_ori = packet->cam_vts[i].ori;
+            geometry::vol::vol_nfo volume_nfo;
+            if (geometry::test(packet->cam_vts[i].dir, &grid_ori, &volume_nfo))
+            {
+                if (primary_hits.lookup_version(packet->cache_ndces[i], version, cached_hits + i))
+                {
+                    cached_mask |= (1 << i);
+                }
+                else if (!brick_depths.segment(packet->pixel_ndces[i], (grid_ori - packet->cam_vts[i].ori).magnitude(), segs + i))
+                {
+                    hits[i].hit = false;
+                    skipped_mask |= (1 << i);
+                }
+                else
+                {
+                    rays[i] = geometry::make_dda_ray(grid_ori, packet->cam_vts[i].dir);
+                    lane_mask |= (1 << i);
+                }
+            }
+        }
+        if (lane_mask != 0)
+        {
+            geometry::packet_isect(rays, lane_mask, hits, segs);
+        }
+        lane_mask |= skipped_mask;
+        for (u8 i = 0; i < packet->size; i++)
+        {
+            if ((cached_mask >> i) & 1)
+            {
+                hits[i] = cached_hits[i];
+            }
+            else if ((lane_mask >> i) & 1)
+            {
+                primary_hits.store(packet->cache_ndces[i], hits[i], version);
+            }
+        }
+        lane_mask |= cached_mask;
+
+        // Continue each path from its resolved primary hit
+        for (u8 i = 0; i < packet->size; i++)
+        {
+            const u32 pixel_ndx = packet->pixel_ndces[i];
+            spectra::lanes nee = 0.0f;
+            path_accumulator camera_path(packet->cam_vts[i].rho_sample); // Unidirectional integration only needs running path weights, so we
+                                                                         // stream vertices into those instead of storing them in [cameraPaths]
+            scene::isect(packet->cam_vts[i],
+                &camera_path, isosurf_distances + pixel_ndx, tileNdx, ((lane_mask >> i) & 1) ? hits + i : nullptr, &nee,
+                render_mode_termination[renderMode]);
+            //scene::isect(lights::sky_sample(x, y, sample[0]), lightPaths[tileNdx]);
+
+            // Integrate scene contributions (unidirectional for now)
+            spectra::lanes rho, rho_weight;
+            float pdf, power;
+            camera_path.resolve_path_weights(&rho, &pdf, &rho_weight, &power);
+            resolve_sample(rho, rho_weight, pdf, power, pixel_ndx, tileNdx, nee);
         }
+        packet->size = 0;
+    }
+
+#ifdef BIDIRECTIONAL_PREVIEW
+    // Trace one bidirectional sample (see [scene::bdpt_path_value]); camera & light subpaths are stored in full, then every camera
+    // vertex connects to the sky and to every light vertex
+    void trace_bidirectional(const path_vt& cam_vt, u32 pixel_ndx, u32 cache_ndx, u32 tileNdx)
+    {
+        path& camera_path = cameraPaths[tileNdx];
+        path& light_path = lightPaths[tileNdx];
+        const spectra::lanes rho = cam_vt.rho_sample;
+
+        // Primary hits go through [primary_hits], same as [trace_primary_packet] (per-pixel isosurface jumps would skip geometry that
+        // other strategies can still reach)
+        geometry::traversal_hit primary_hit;
+        bool primary_resolved = false;
+        vmath::vec<3> grid_ori = cam_vt.ori;
+        geometry::vol::vol_nfo volume_nfo;
+        const u32 version = primary_hits.current_version(); // Read before the view, same as [brick_depth_prepass]
+        if (geometry::test(cam_vt.dir, &grid_ori, &volume_nfo))
+        {
+            if (!primary_hits.lookup_version(cache_ndx, version, &primary_hit))
+            {
+                geometry::dda_isect(geometry::make_dda_ray(grid_ori, cam_vt.dir), &primary_hit, false);
+                primary_hits.store(cache_ndx, primary_hit, version);
+            }
+            primary_resolved = true;
+        }
+        scene::isect(cam_vt, &camera_path, isosurf_distances + pixel_ndx, tileNdx, primary_resolved ? &primary_hit : nullptr, nullptr,
+                     scene::bdpt_termination);
+
+        float sample[4];
+        parallel::rand_streams[tileNdx].next(sample);
+        vmath::vec<3> light_sky_dir;
+        float disc_pdf = 0.0f;
+        float light_isosurf_dist = -1.0f; // Light rays don't share the per-pixel isosurface cache
+        scene::isect(scene::bdpt_light_vt(rho, sample, &light_sky_dir, &disc_pdf), &light_path, &light_isosurf_dist, tileNdx, nullptr, nullptr,
+                     scene::bdpt_termination);
+
+        // Sky vertices only ever close paths, so they never take part in connections
+        const bool camera_escaped = camera_path.size > 0 && camera_path.vts[camera_path.size - 1].normal.sqr_magnitude() == 0.0f;
+        const u32 num_camera_vts = camera_path.size - (camera_escaped ? 1 : 0);
+        const u32 num_light_vts = (light_path.size > 0 && light_path.vts[light_path.size - 1].normal.sqr_magnitude() == 0.0f) ? light_path.size - 1 : light_path.size;
+
+        // Paths never scattering in the volume can only come from camera rays, so they keep their unidirectional weights; other escaping
+        // camera paths are re-weighted against every other strategy, same as the connections below
+        spectra::lanes rho_weight, rho_out;
+        float pdf, power;
+        camera_path.resolve_path_weights(&rho_out, &pdf, &rho_weight, &power);
+        const path_vt* vts[scene::bdpt_max_subpath_vts * 2];
+        for (u32 s = 0; s < num_camera_vts; s++)
+        {
+            vts[s] = camera_path.vts + s;
+        }
+        spectra::lanes direct = 0.0f;
+        if (camera_escaped && num_camera_vts > 0)
+        {
+            direct += scene::bdpt_path_value(vts, num_camera_vts, cam_vt.dir, cam_vt.power, camera_path.vts[camera_path.size - 1].dir, rho, disc_pdf);
+            power = 0.0f;
+        }
+
+        // Connect each camera vertex to the sky, then to each light vertex
+        for (u32 s = 1; s <= num_camera_vts; s++)
+        {
+            const path_vt& camera_vt = camera_path.vts[s - 1];
+            vts[s - 1] = &camera_vt; // Connections from the previous vertex leave light vertices here
+            parallel::rand_streams[tileNdx].next(sample);
+            float sky_pdf = 0.0f;
+            const vmath::vec<3> sky_dir = lights::sky_importance.sample(rho.e[0], sample[0], sample[1], &sky_pdf);
+            if (!geometry::dda_occluded(geometry::make_dda_ray(camera_vt.ori, sky_dir), geometry::dda_segment(), true))
+            {
+                direct += scene::bdpt_path_value(vts, s, cam_vt.dir, cam_vt.power, sky_dir, rho, disc_pdf);
+            }
+            for (u32 t = 1; t <= num_light_vts; t++)
+            {
+                const path_vt& light_vt = light_path.vts[t - 1];
+                for (u32 j = 0; j < t; j++)
+                {
+                    vts[s + j] = light_path.vts + (t - 1 - j);
+                }
+                if (scene::bdpt_visible(camera_vt.ori, light_vt.ori))
+                {
+                    direct += scene::bdpt_path_value(vts, s + t, cam_vt.dir, cam_vt.power, light_sky_dir, rho, disc_pdf);
+                }
+            }
+        }
+
+        camera_path.clear();
+        light_path.clear();
+        resolve_sample(rho_out, rho_weight, pdf, power, pixel_ndx, tileNdx, direct);
+    }
+#endif
+
+    // Drain the wavefront queue for the given tile; extend & shade every live path until they've all escaped or been absorbed, then
+    // splat finished paths onto the sensor
+    void wavefront_flush(u32 tileNdx)
+    {
+        ray_queue& rays = wavefront_rays[tileNdx];
+        splat_queue& splats = wavefront_splats[tileNdx];
+        bool camera_rays = true;
+        while (rays.size > 0)
+        {
+            scene::extend(&rays, camera_rays, &primary_hits, &brick_depths);
+            scene::shade(&rays, &splats, tileNdx, render_mode_termination[renderMode]);
+            camera_rays = false;
+        }
+        for (u32 i = 0; i < splats.size; i++)
+        {
+            resolve_sample(splats.rho[i], splats.rho_weight[i], splats.pdf[i], splats.power[i], splats.pixel_ndx[i], tileNdx, splats.nee[i]);
+        }
+        splats.size = 0;
     }
 
     // Core image integrator - shared across all render modes for simplicity
     // The idea is that every mode gets here eventually, but they vary in how pipelined they are and whether they send
     // updates to the window
-    void core_image_integrator(u32 tileNdx, i32 stride, i32 minY, i32 yMax, i32 minX, i32 xMax, bool bg_prepass)
+    // Returns the number of pixels sampled
+    u32 core_image_integrator(u32 tileNdx, i32 stride, i32 minY, i32 yMax, i32 minX, i32 xMax, bool bg_prepass)
     {
         // Starting another sample for every pixel in the current tile
         sample_ctr[tileNdx]++;
         i32 dy = stride;
+        primary_packet packet;
+
+        // Route pixels outside the volume's coverage straight to the sky (stale masks are ignored, so every pixel traces normally
+        // until the next prepass)
+        const tile_coverage& cov = coverage[tileNdx];
+        const bool coverage_valid = !bg_prepass && cov.valid(minX, xMax, minY, yMax);
+        const bool tile_sky_only = bg_prepass || (coverage_valid && cov.num_covered == 0);
+
+        // Past the first few passes, adaptive sampling only revisits the noisiest blocks in each tile
+        const bool adaptive_pass = adaptive_sampling_enabled && !bg_prepass && renderMode != RENDER_MODE_EDIT &&
+                                   sample_ctr[tileNdx] > adaptive_min_samples;
+        const adaptive_tile_state& adaptive_state = adaptive_tiles[tileNdx];
+        const float error_cutoff = vmath::max(adaptive_target_error, adaptive_state.mean_error * adaptive_focus);
+        const u32 blocks_x = ((xMax - minX) + adaptive_block_size - 1) / adaptive_block_size;
+        u32 num_sampled = 0;
 
         // Image resolution/path tracing
         for (i32 y = minY; y < yMax; y += dy)
@@ -93,8 +845,28 @@ namespace tracing
             i32 dx = stride;
             for (i32 x = minX; x < xMax; x += dx)
             {
+                // Modify d-x to avoid skipping the final column in each tile
+                if ((xMax - x) <= stride)
+                {
+                    dx = 1;
+                }
+
                 // Core path integrator, + demo effects
                 u32 pixel_ndx = y * ui::window_width + x;
+                if (adaptive_pass)
+                {
+                    const u32 block_ndx = ((x - minX) / adaptive_block_size) + ((y - minY) / adaptive_block_size) * blocks_x;
+                    if (camera::sensor_samples(pixel_ndx) >= adaptive_max_samples ||
+                        adaptive_state.block_errors[block_ndx] < error_cutoff)
+                    {
+                        continue;
+                    }
+                }
+                else if (renderMode == RENDER_MODE_EDIT && camera::sensor_samples(pixel_ndx) >= aa::max_samples)
+                {
+                    continue; // Saturated; lets EDIT passes get cheaper (and their strides finer) while the view is still
+                }
+                num_sampled++;
 #define DEMO_SPECTRAL_PT
                 //#define DEMO_FILM_RESPONSE
                 //#define DEMO_XOR
@@ -121,69 +893,150 @@ namespace tracing
                 camera::sensor_response(sample[0], 1.0f, pixel_ndx, sample_ctr[tileNdx]);
                 camera::tonemap_out(pixel_ndx);
 #elif defined (DEMO_FILM_RESPONSE) // Rainbow gradient test
-                camera::sensor_response((float)x / (float)ui::window_width, 1.0f / aa::max_samples, 1.0f, 1.0f, pixel_ndx, sample_ctr[tileNdx]);
+                camera::sensor_response(spectra::lanes((float)x / (float)ui::window_width), 1.0f / aa::max_samples, 1.0f, 1.0f, pixel_ndx, sample_ctr[tileNdx],
+                                        aa::max_samples); // One wavelength in every lane, so the gradient stays a plain rainbow with hero wavelengths enabled
                 camera::tonemap_out(pixel_ndx);
 #elif defined (DEMO_SPECTRAL_PT)
                             // Draw random values for lens sampling
                 float sample[4];
                 parallel::rand_streams[tileNdx].next(sample);
 
-                // Resolve a spectral sample for the current pixel
-                float s = spectral_strata[pixel_ndx].draw_sample(sample[0], sample[1]);
+                // Resolve a spectral sample for the current pixel, then spread companion wavelengths around it
+                // Companion wavelengths are only weighted correctly for uniform heroes, so we skip the bucket importance sampler for those
+                // (see [spectra::hero_wavelengths])
+                const float s = spectra::hero_wavelengths_enabled ? sample[0] : spectral_strata[pixel_ndx].draw_sample(sample[0], sample[1]);
 
                 // Intersect the scene/the background
-                float rho, pdf, rho_weight, power;
-                const path_vt cam_vt = camera::lens_sample((float)x, (float)y, sample[2], sample[3], s);
-                if (!bg_prepass) // If not shading the background, scatter light through the scene
+                const path_vt cam_vt = camera::lens_sample((float)x, (float)y, sample[2], sample[3], spectra::hero_wavelengths(s));
+                const u32 hit_cache_ndx = pixel_ndx * aa::max_samples + aa::subpixel_ndx(sample[2], sample[3]); // Lens samples jitter with [sample[2]]/[sample[3]]
+                const bool sky_only = tile_sky_only || (coverage_valid && !cov.covered(x, y));
+#ifdef BIDIRECTIONAL_PREVIEW
+                if (!sky_only && renderMode == RENDER_MODE_BIDIRECTIONAL_PREVIEW) // Bidirectional integration stores both subpaths in full, so it
+                                                                                  // runs per-sample instead of through packets/queues
                 {
-                    scene::isect(cam_vt,
-                        cameraPaths + tileNdx, isosurf_distances + pixel_ndx, tileNdx);
-                    //scene::isect(lights::sky_sample(x, y, sample[0]), lightPaths[tileNdx]);
-
-                    // Integrate scene contributions (unidirectional for now)
-                    cameraPaths[tileNdx].resolve_path_weights(&rho, &pdf, &rho_weight, &power); // Light/camera path merging decisions are performed while we integrate camera paths,
-                                                                                                // so we only need to resolve weights for one batch
-
-                    // Remove the current path from the backlog for this tile
-                    // (BDPT/VCM implementation will delay this until after separately tracing every path)
-                    cameraPaths[tileNdx].clear();
-                    //lightPaths[tileNdx].clear();
-
-                    // Test for unresolved/buggy paths
-                    //if (cameraPaths[tileNdx].front > 0) platform::osDebugBreak();
+                    trace_bidirectional(cam_vt, pixel_ndx, hit_cache_ndx, tileNdx);
                 }
-                else // Otherwise hop directly to the sky
+                else
+#endif
+                if (!sky_only && integrator == INTEGRATOR_WAVEFRONT) // Generate stage for wavefront integration; queue camera rays, and drain the
+                                                                     // queue whenever it fills up
+                {
+                    wavefront_rays[tileNdx].push(cam_vt, pixel_ndx, hit_cache_ndx);
+                    if (wavefront_rays[tileNdx].size == ray_queue::capacity)
+                    {
+                        wavefront_flush(tileNdx);
+                    }
+                }
+                else if (!sky_only) // If not shading the background, scatter light through the scene
+                {
+                    // Primary rays from neighbouring pixels follow almost identical paths through the grid, so queue them up and
+                    // traverse them together
+                    packet.cam_vts[packet.size] = cam_vt;
+                    packet.pixel_ndces[packet.size] = pixel_ndx;
+                    packet.cache_ndces[packet.size] = hit_cache_ndx;
+                    packet.size++;
+                    if (packet.size == geometry::packet_width)
+                    {
+                        trace_primary_packet(&packet, tileNdx);
+                    }
+                }
+                else // Otherwise hop directly to the sky (background prepass, or pixels without volume coverage)
                      // Similar code to the escaped-path light sampling in [scene.ixx]
                 {
+                    spectra::lanes rho, rho_weight;
+                    float pdf, power;
                     vmath::vec<3> ori = cam_vt.ori + (cam_vt.dir * lights::sky_dist);
                     rho = cam_vt.rho_sample;
                     rho_weight = spectra::sky(cam_vt.rho_sample, cam_vt.dir.e[1]);
                     power = cam_vt.power * lights::sky_env(&pdf);
-                    pdf = 1.0f; // No scene sampling and uniform sky (for now), so we assume 100% probability for all rays (=> all rays are equally likely)
+                    if (bg_prepass)
+                    {
+                        pdf = 1.0f; // No scene sampling and uniform sky (for now), so we assume 100% probability for all rays (=> all rays are equally likely)
+                    }
+                    // Pixels skipped by coverage keep the sky pdf, so they resolve exactly like paths escaping through [scene::isect]
+                    resolve_sample(rho, rho_weight, pdf, power, pixel_ndx, tileNdx);
                 }
+#endif
+            }
 
-                // Compute sensor response + apply sample weight (composite of integration weight for spectral accumulation,
-                // lens-sampled filter weight for AA, and path index weights from ray propagation)
-                camera::sensor_response(rho, rho_weight, pdf, power, pixel_ndx, sample_ctr[tileNdx]);
+#ifdef DEMO_SPECTRAL_PT
+            // Flush partially-filled packets at the end of each row
+            if (packet.size > 0)
+            {
+                trace_primary_packet(&packet, tileNdx);
+            }
+#endif
 
-                // Map resolved sensor responses back into tonemapped RGB values we can store for output
-                camera::tonemap_out(pixel_ndx);
+            // Modify d-y to avoid skipping the final row in each tile
+            if ((yMax - y) <= stride)
+            {
+                dy = 1;
+            }
+        }
 
-                // Update weight for the bucket containing the current spectral sample
-                spectral_strata[pixel_ndx].update(rho_weight);
+#ifdef DEMO_SPECTRAL_PT
+        // Resolve any wavefront paths still in flight
+        if (wavefront_rays[tileNdx].size > 0)
+        {
+            wavefront_flush(tileNdx);
+        }
 #endif
-                // Modify d-x to avoid skipping the final column in each tile
-                if ((xMax - x) <= stride)
+
+        // Refresh error estimates for the next adaptive pass
+        if (adaptive_sampling_enabled && !bg_prepass && renderMode != RENDER_MODE_EDIT && sample_ctr[tileNdx] >= adaptive_min_samples)
+        {
+            float luma_sum = 0.0f;
+            for (i32 y = minY; y < yMax; y++)
+            {
+                for (i32 x = minX; x < xMax; x++)
                 {
-                    dx = 1;
+                    luma_sum += vmath::fabs(camera::sensor_luma(y * ui::window_width + x));
                 }
             }
+            const float luma_floor = vmath::max(adaptive_luma_floor * luma_sum / static_cast<float>((xMax - minX) * (yMax - minY)), vmath::eps);
 
-            // Modify d-y to avoid skipping the final row in each tile
-            if ((yMax - y) <= stride)
+            // Block errors are the average standard error over each block's unfinished pixels, relative to the block's
+            // average luminance
+            adaptive_tile_state& state = adaptive_tiles[tileNdx];
+            float error_sum = 0.0f;
+            u32 num_unfinished_blocks = 0;
+            u32 block_ndx = 0;
+            for (i32 block_y = minY; block_y < yMax; block_y += adaptive_block_size)
             {
-                dy = 1;
+                for (i32 block_x = minX; block_x < xMax; block_x += adaptive_block_size)
+                {
+                    float block_luma = 0.0f;
+                    float block_se = 0.0f;
+                    u32 num_pixels = 0;
+                    u32 num_unfinished = 0;
+                    const i32 block_y_max = vmath::min(block_y + static_cast<i32>(adaptive_block_size), yMax);
+                    const i32 block_x_max = vmath::min(block_x + static_cast<i32>(adaptive_block_size), xMax);
+                    for (i32 y = block_y; y < block_y_max; y++)
+                    {
+                        for (i32 x = block_x; x < block_x_max; x++)
+                        {
+                            const u32 pixel_ndx = y * ui::window_width + x;
+                            block_luma += vmath::fabs(camera::sensor_luma(pixel_ndx));
+                            num_pixels++;
+                            if (camera::sensor_samples(pixel_ndx) < adaptive_max_samples)
+                            {
+                                block_se += camera::standard_error(pixel_ndx);
+                                num_unfinished++;
+                            }
+                        }
+                    }
+
+                    float block_error = 0.0f;
+                    if (num_unfinished > 0)
+                    {
+                        block_error = (block_se / num_unfinished) / vmath::max(block_luma / num_pixels, luma_floor);
+                        error_sum += block_error;
+                        num_unfinished_blocks++;
+                    }
+                    state.block_errors[block_ndx++] = block_error;
+                }
             }
+            state.mean_error = (num_unfinished_blocks > 0) ? error_sum / num_unfinished_blocks : 0.0f;
         }
 
         // Stridden pixel reconstruction
@@ -203,6 +1056,158 @@ namespace tracing
                 }
             }
         }
+        return num_sampled;
+    }
+
+    // Whether a final-mode tile still has samples to take; sky prepasses (and builds without adaptive sampling) always take
+    // [aa::max_samples] passes, adaptive tiles run until [core_image_integrator] finds every pixel under the error target
+    bool tile_needs_samples(u32 tileNdx, bool bg_prepass)
+    {
+        if (!adaptive_sampling_enabled || bg_prepass)
+        {
+            return sample_ctr[tileNdx] <= aa::max_samples;
+        }
+        return sample_ctr[tileNdx] < adaptive_min_samples || adaptive_tiles[tileNdx].mean_error > adaptive_target_error;
+    }
+
+    // Adaptive undersampling for EDIT mode
+    // Each tile picks its own stride (1, 2, 4 or 8) from the measured cost of its recent passes, aiming to keep every pass
+    // inside [edit_frame_budget_ms] so the view reacts to input at a steady rate. Strides only get finer when the predicted
+    // pass time leaves some headroom, and only get coarser after several passes over budget, so tiles don't flicker between
+    // resolutions
+    // Pixels stop sampling once they saturate (see [core_image_integrator]); when every pixel at the current stride has
+    // saturated the view must be still, so we keep refining at finer strides in bands of rows sized to fit the budget
+    constexpr double edit_frame_budget_ms = 16.0;
+    constexpr double edit_refine_headroom = 0.75; // Step finer when the predicted pass time is under this fraction of the budget
+    constexpr u32 edit_coarsen_passes = 3; // Step coarser after this many consecutive passes over budget
+    constexpr u8 edit_max_stride = 8;
+    constexpr u32 edit_min_timed_samples = 64; // Passes smaller than this are mostly fixed overhead, so they're left out of our cost estimates
+
+    // Number of unsaturated pixels an EDIT pass at [stride] would sample; walks the same lattice as [core_image_integrator]
+    u32 edit_pending_samples(i32 stride, i32 minY, i32 yMax, i32 minX, i32 xMax)
+    {
+        u32 num_pending = 0;
+        i32 dy = stride;
+        for (i32 y = minY; y < yMax; y += dy)
+        {
+            i32 dx = stride;
+            for (i32 x = minX; x < xMax; x += dx)
+            {
+                if ((xMax - x) <= stride)
+                {
+                    dx = 1;
+                }
+                if (camera::sensor_samples(y * ui::window_width + x) < aa::max_samples)
+                {
+                    num_pending++;
+                }
+            }
+            if ((yMax - y) <= stride)
+            {
+                dy = 1;
+            }
+        }
+        return num_pending;
+    }
+
+    struct edit_stride_controller
+    {
+        u8 stride = edit_max_stride; // Interactive stride; no timings yet, so start as cheap as possible
+        double ms_per_sample = 0.0; // Smoothed cost of each pixel sample over recent passes
+        u32 passes_over_budget = 0;
+        i32 refine_row = 0; // Next band to refine, relative to the top of the tile
+
+        // Stride + row band for the next pass
+        i32 pass_stride = edit_max_stride;
+        i32 pass_min_y = 0;
+        i32 pass_max_y = 0;
+        bool refining = false;
+
+        void plan(i32 minY, i32 yMax, i32 minX, i32 xMax)
+        {
+            pass_stride = stride;
+            pass_min_y = minY;
+            pass_max_y = yMax;
+            refining = false;
+            if (edit_pending_samples(stride, minY, yMax, minX, xMax) > 0 || stride == 1 || ms_per_sample <= 0.0)
+            {
+                return;
+            }
+
+            // Every pixel at the interactive stride has saturated; find the coarsest finer stride with work left
+            for (pass_stride = stride / 2; pass_stride > 1; pass_stride /= 2)
+            {
+                if (edit_pending_samples(pass_stride, minY, yMax, minX, xMax) > 0) break;
+            }
+
+            // Refine one band of rows per pass, sweeping down the tile and wrapping around until the band's pixels saturate
+            const double row_ms = ms_per_sample * ((xMax - minX) / pass_stride);
+            const i32 band_rows = vmath::max(static_cast<i32>(edit_frame_budget_ms / row_ms), 1) * pass_stride;
+            refining = true;
+            pass_min_y = minY + refine_row;
+            pass_max_y = vmath::min(pass_min_y + band_rows, static_cast<i32>(yMax));
+            refine_row = (pass_max_y >= yMax) ? 0 : (pass_max_y - minY);
+        }
+
+        // Feed back timings from the last pass
+        void update(double pass_ms, u32 num_sampled, i32 minY, i32 yMax, i32 minX, i32 xMax)
+        {
+            if (num_sampled >= edit_min_timed_samples)
+            {
+                const double pass_ms_per_sample = pass_ms / num_sampled;
+                ms_per_sample = (ms_per_sample > 0.0) ? (ms_per_sample * 0.75) + (pass_ms_per_sample * 0.25) : pass_ms_per_sample;
+            }
+            if (refining) return; // Refinement passes are sized to the budget up-front
+
+            if (pass_ms > edit_frame_budget_ms)
+            {
+                passes_over_budget++;
+                if (passes_over_budget >= edit_coarsen_passes && stride < edit_max_stride)
+                {
+                    stride *= 2;
+                    passes_over_budget = 0;
+                }
+            }
+            else
+            {
+                passes_over_budget = 0;
+                if (stride > 1 && ms_per_sample > 0.0)
+                {
+                    const double finer_ms = ms_per_sample * edit_pending_samples(stride / 2, minY, yMax, minX, xMax);
+                    if (finer_ms < (edit_frame_budget_ms * edit_refine_headroom))
+                    {
+                        stride /= 2;
+                    }
+                }
+            }
+        }
+
+        // Scene/view changes reset every pixel, so passes at fine strides suddenly get much more expensive; jump straight to
+        // the finest stride we expect to fit in the budget, instead of waiting for passes to run over
+        void reset(i32 minY, i32 yMax, i32 minX, i32 xMax)
+        {
+            passes_over_budget = 0;
+            refine_row = 0;
+            if (ms_per_sample <= 0.0) return;
+            while (stride < edit_max_stride && (ms_per_sample * edit_pending_samples(stride, minY, yMax, minX, xMax)) > edit_frame_budget_ms)
+            {
+                stride *= 2;
+            }
+        }
+    };
+
+    // Average samples per-pixel over a tile, for logging
+    float tile_average_spp(i32 minX, i32 xMax, i32 minY, i32 yMax)
+    {
+        u64 num_samples = 0;
+        for (i32 y = minY; y < yMax; y++)
+        {
+            for (i32 x = minX; x < xMax; x++)
+            {
+                num_samples += camera::sensor_samples(y * ui::window_width + x);
+            }
+        }
+        return static_cast<float>(num_samples) / static_cast<float>((xMax - minX) * (yMax - minY));
     }
 
     export void trace(u16 tilesX, u16 tilesY, u16 tileNdx)
@@ -229,9 +1234,16 @@ namespace tracing
         // Sensels skipped by sample stride are approximated using bilinear interpolation (see camera.ixx)
         // Stride in practice is equal to the number of pixels skipped + 1 (so zero pixels is stride 1, one pixel is stride 2, etc)
         // Thinking of modifying the flow to help with readability there
-        constexpr u8 edit_stride = 4; // Eventually this will be driven by imgui
+        edit_stride_controller edit_stride; // Driven by pass timings, see [edit_stride_controller]
         constexpr u8 final_stride = 1;
 
+        // EDIT previews are denoised after passes adding new samples, at most once per [denoise::interval_ms] (or less often, if filtering
+        // would take more than [denoise::max_time_share] of the tile's time); the first sampled pass after each spin/zoom is always filtered,
+        // since nothing else writes denoised previews to the screen (see [denoised_preview])
+        double denoise_timepoint = 0;
+        double denoise_ms = 0;
+        bool denoise_pending = false;
+
         // Local switches to shift between spreading threads over the window to shade the background vs focussing them
         // all on the volume
         bool bg_prepass = true;
@@ -246,17 +1258,29 @@ namespace tracing
         double tick_timepoint = 0;
         double sample_timings = 0;
         bool tile_resolved = false;
+        brick_depth_prepass(tileNdx, minX, xMax, minY, yMax);
         while (draws_running_local)
         {
             // Clear render state on scene update
             if (views_resampling[tileNdx].load() > 0)
             {
+                // EDIT tiles carry their samples over into the new view where they can (see [reproject_tile_history])
+                const bool reprojecting = temporal_reprojection_enabled && renderMode == RENDER_MODE_EDIT &&
+                                          gather_reprojection_sources(tileNdx, minX, xMax, minY, yMax);
                 clear_render_state(tileNdx, minX, xMax, minY, yMax);
                 views_resampling[tileNdx].store(0);
+                denoise_timepoint = 0;
+                brick_depth_prepass(tileNdx, minX, xMax, minY, yMax);
+                if (reprojecting)
+                {
+                    reproject_tile_history(tileNdx, minX, xMax, minY, yMax);
+                    denoise_pending = true;
+                }
+                edit_stride.reset(minY, yMax, minX, xMax);
             }
 
             // Avoid processing tiles once all samples have resolved (final render modes only)
-            if (renderMode == RENDER_MODE_FINAL_PREVIEW || renderMode == RENDER_MODE_FINAL_TO_FILE)
+            if (renderMode == RENDER_MODE_FINAL_PREVIEW || renderMode == RENDER_MODE_BIDIRECTIONAL_PREVIEW || renderMode == RENDER_MODE_FINAL_TO_FILE)
             {
                 if (tile_resolved) continue;
             }
@@ -266,10 +1290,10 @@ namespace tracing
             samples_processed = parallel::tiles[tileNdx].messaging->load() > 0;
             if (!samples_processed)
             {
-                if (renderMode == RENDER_MODE_FINAL_PREVIEW || renderMode == RENDER_MODE_FINAL_TO_FILE)
+                if (renderMode == RENDER_MODE_FINAL_PREVIEW || renderMode == RENDER_MODE_BIDIRECTIONAL_PREVIEW || renderMode == RENDER_MODE_FINAL_TO_FILE)
                 {
                     // Stop rendering when we've taken all the image samples we want
-                    if (sample_ctr[tileNdx] <= aa::max_samples)
+                    if (tile_needs_samples(tileNdx, bg_prepass))
                     {
                         // If not the background prepass, test if every tile has finished sky sampling before we remap our threads
                         if (!bg_prepass && !volume_tracing)
@@ -310,6 +1334,9 @@ namespace tracing
                                 tracing_tile_bounds[tileNdx].e[1] = yMax;
                                 tracing_tile_sizes[tileNdx].e[0] = tile_width;
                                 tracing_tile_sizes[tileNdx].e[1] = tile_height;
+
+                                // Resolve brick depths over the new tile bounds
+                                brick_depth_prepass(tileNdx, minX, xMax, minY, yMax);
                             }
                         }
 
@@ -322,7 +1349,15 @@ namespace tracing
                         if (!bg_prepass)
                         {
                             // Log to console once we finish sampling the volume
-                            platform::osDebugLogFmt("%iSPP rendering completed for tile %i\n", aa::max_samples, tileNdx);
+                            if constexpr (adaptive_sampling_enabled)
+                            {
+                                platform::osDebugLogFmt("adaptive rendering completed for tile %i (%f average SPP)\n", tileNdx, tile_average_spp(minX, xMax, minY, yMax));
+                            }
+                            else
+                            {
+                                platform::osDebugLogFmt("%iSPP rendering completed for tile %i\n", aa::max_samples, tileNdx);
+                            }
+                            scene::log_path_lengths(tileNdx);
                             tile_sampling_finished = true;
 
                             // Signal the current tile has finished sampling
@@ -354,7 +1389,29 @@ namespace tracing
                 else if (renderMode == RENDER_MODE_EDIT)
                 {
                     // No pre-passes or other data marshalling (yet) - straight into image integration
-                    core_image_integrator(tileNdx, edit_stride, minY, yMax, minX, xMax, false); // No pre-passes in edit mode
+                    if constexpr (temporal_reprojection_enabled)
+                    {
+                        record_reprojection_view(tileNdx);
+                    }
+                    edit_stride.plan(minY, yMax, minX, xMax);
+                    const double pass_start = platform::osGetCurrentTimeMilliSeconds();
+                    const u32 num_sampled = core_image_integrator(tileNdx, edit_stride.pass_stride, edit_stride.pass_min_y, edit_stride.pass_max_y, minX, xMax, false); // No pre-passes in edit mode
+                    edit_stride.update(platform::osGetCurrentTimeMilliSeconds() - pass_start, num_sampled, minY, yMax, minX, xMax);
+
+                    // Denoise outside the timed pass, so the stride controller only budgets for sampling
+                    if constexpr (denoise::enabled)
+                    {
+                        denoise_pending |= num_sampled > 0;
+                        const double denoise_start = platform::osGetCurrentTimeMilliSeconds();
+                        if (denoise_pending && (denoise_start - denoise_timepoint) >= vmath::max(denoise::interval_ms, denoise_ms / denoise::max_time_share))
+                        {
+                            resolve_denoise_guides(minX, xMax, minY, yMax);
+                            denoise::filter_tile(tileNdx, minX, xMax, minY, yMax);
+                            denoise_timepoint = denoise_start;
+                            denoise_ms = platform::osGetCurrentTimeMilliSeconds() - denoise_start;
+                            denoise_pending = false;
+                        }
+                    }
 
                     // Signal a completed sampling iteration
                     parallel::tiles[tileNdx].messaging->store(1);
@@ -372,12 +1429,49 @@ namespace tracing
     export void init()
     {
         // Allocate tracing arrays
+#ifdef BIDIRECTIONAL_PREVIEW
         cameraPaths = mem::allocate_tracing<path>(sizeof(path) * parallel::numTiles);
+        lightPaths = mem::allocate_tracing<path>(sizeof(path) * parallel::numTiles);
+#endif
         sample_ctr = mem::allocate_tracing<u32>(sizeof(u32) * parallel::numTiles);
+        adaptive_tiles = mem::allocate_tracing<adaptive_tile_state>(sizeof(adaptive_tile_state) * parallel::numTiles);
         tracing_tile_positions = mem::allocate_tracing<vmath::vec<2>>(sizeof(vmath::vec<2>) * parallel::numTiles);
         tracing_tile_bounds = mem::allocate_tracing<vmath::vec<2>>(sizeof(vmath::vec<2>) * parallel::numTiles);
         tracing_tile_sizes = mem::allocate_tracing<vmath::vec<2>>(sizeof(vmath::vec<2>) * parallel::numTiles);
-        isosurf_distances = (float*)mem::allocate_tracing<float>(sizeof(float) * ui::window_area); // Eventually this will be per-subpixel instead of per-macropixel
+        isosurf_distances = (float*)mem::allocate_tracing<float>(sizeof(float) * ui::window_area); // Per-macropixel; [primary_hits] covers the per-subpixel case
+        primary_hits.entries = mem::allocate_tracing<geometry::primary_hit_cache::entry>(sizeof(geometry::primary_hit_cache::entry) * ui::window_area * aa::max_samples);
+        brick_depths.spans = mem::allocate_tracing<geometry::brick_depth_map::span>(sizeof(geometry::brick_depth_map::span) * ui::window_area);
+        coverage = mem::allocate_tracing<tile_coverage>(sizeof(tile_coverage) * parallel::numTiles);
+        coverage_words_per_tile = (((ui::window_width / parallel::numTilesX) + 1) * ((ui::window_height / parallel::numTilesY) + 1) + 63) / 64;
+        for (u32 i = 0; i < parallel::numTiles; i++)
+        {
+            coverage[i] = tile_coverage();
+            coverage[i].bits = mem::allocate_tracing<u64>(sizeof(u64) * coverage_words_per_tile);
+        }
+        if constexpr (temporal_reprojection_enabled)
+        {
+            reprojection_surfaces = mem::allocate_tracing<reprojection_surface>(sizeof(reprojection_surface) * ui::window_area);
+            reprojection_sources = mem::allocate_tracing<reprojection_source>(sizeof(reprojection_source) * ui::window_area);
+            reprojection_depths = mem::allocate_tracing<float>(sizeof(float) * ui::window_area);
+            reprojection_views = mem::allocate_tracing<reprojection_view>(sizeof(reprojection_view) * parallel::numTiles);
+            platform::osClearMem(reprojection_surfaces, sizeof(reprojection_surface) * ui::window_area); // Zero type is [REPROJECTION_NONE]
+            for (u32 i = 0; i < parallel::numTiles; i++)
+            {
+                reprojection_views[i] = reprojection_view();
+            }
+        }
+        wavefront_rays = mem::allocate_tracing<ray_queue>(sizeof(ray_queue) * parallel::numTiles);
+        wavefront_splats = mem::allocate_tracing<splat_queue>(sizeof(splat_queue) * parallel::numTiles);
+        lights::init_sky_distribution();
+        if constexpr (denoise::enabled)
+        {
+            denoise::init();
+        }
+        if constexpr (scene::path_length_stats_enabled)
+        {
+            scene::path_length_histograms = mem::allocate_tracing<u64>(sizeof(u64) * scene::path_length_bins * parallel::numTiles);
+            platform::osClearMem(scene::path_length_histograms, sizeof(u64) * scene::path_length_bins * parallel::numTiles);
+        }
 
         // Allocate & initialize spectral strata
         spectral_strata = mem::allocate_tracing<spectra::spectral_buckets>(sizeof(spectra::spectral_buckets) * ui::window_area);
@@ -387,12 +1481,28 @@ namespace tracing
         }
 
         // Resolve tracing types
+#ifdef BIDIRECTIONAL_PREVIEW
         platform::osClearMem(cameraPaths, sizeof(path) * parallel::numTiles);
+        platform::osClearMem(lightPaths, sizeof(path) * parallel::numTiles);
+#endif
+        platform::osClearMem(wavefront_rays, sizeof(ray_queue) * parallel::numTiles);
+        platform::osClearMem(wavefront_splats, sizeof(splat_queue) * parallel::numTiles);
+        platform::osClearMem(primary_hits.entries, sizeof(geometry::primary_hit_cache::entry) * ui::window_area * aa::max_samples); // Zero versions never match a loaded volume
+        platform::osClearMem(brick_depths.spans, sizeof(geometry::brick_depth_map::span) * ui::window_area);
         for (u32 i = 0; i < ui::window_area; i++)
         {
             isosurf_distances[i] = -1.0f; // Reserve zero distance for voxels directly facing a grid boundary
         }
 
+        adaptive_blocks_per_tile = (((ui::window_width / parallel::numTilesX) + adaptive_block_size) / adaptive_block_size) *
+                                   (((ui::window_height / parallel::numTilesY) + adaptive_block_size) / adaptive_block_size);
+        for (u32 i = 0; i < parallel::numTiles; i++)
+        {
+            adaptive_tiles[i].mean_error = 1.0f;
+            adaptive_tiles[i].block_errors = mem::allocate_tracing<float>(sizeof(float) * adaptive_blocks_per_tile);
+            platform::osClearMem(adaptive_tiles[i].block_errors, sizeof(float) * adaptive_blocks_per_tile);
+        }
+
         // Allocate & initialize draw_state
         draws_running = mem::allocate_tracing<platform::threads::osAtomicInt>(sizeof(platform::threads::osAtomicInt));
         draws_running->init();
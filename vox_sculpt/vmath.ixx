@@ -491,6 +491,71 @@ export namespace vmath
                lhs.e[2] == rhs;
     }
 
+    // 4D
+    // Just enough to carry four-wide spectral lanes (see [spectra::lanes]); no rotations or products that assume a w-coordinate
+    template<vec4_type vec4>
+    const vec4 operator+(vec4 lhs, vec4 rhs)
+    {
+        return vec4(lhs.e[0] + rhs.e[0],
+            lhs.e[1] + rhs.e[1],
+            lhs.e[2] + rhs.e[2],
+            lhs.e[3] + rhs.e[3]);
+    }
+
+    template<vec4_type vec4>
+    const vec4 operator+=(vec4& lhs, vec4 rhs)
+    {
+        lhs = lhs + rhs;
+        return lhs;
+    }
+
+    template<vec4_type vec4>
+    const vec4 operator*(vec4 lhs, vec4 rhs)
+    {
+        return vec4(lhs.e[0] * rhs.e[0],
+            lhs.e[1] * rhs.e[1],
+            lhs.e[2] * rhs.e[2],
+            lhs.e[3] * rhs.e[3]);
+    }
+
+    template<vec4_type vec4>
+    const vec4 operator*=(vec4& lhs, vec4 rhs)
+    {
+        lhs = lhs * rhs;
+        return lhs;
+    }
+
+    template<vec4_type vec4>
+    const vec4 operator*(vec4 lhs, float rhs)
+    {
+        return vec4(lhs.e[0] * rhs,
+            lhs.e[1] * rhs,
+            lhs.e[2] * rhs,
+            lhs.e[3] * rhs);
+    }
+
+    template<vec4_type vec4>
+    const vec4 operator*(float lhs, vec4 rhs)
+    {
+        return rhs * lhs;
+    }
+
+    template<vec4_type vec4>
+    const vec4 operator*=(vec4& lhs, float rhs)
+    {
+        lhs = lhs * rhs;
+        return lhs;
+    }
+
+    template<vec4_type vec4>
+    const vec4 operator/(vec4 lhs, float rhs)
+    {
+        return vec4(lhs.e[0] / rhs,
+            lhs.e[1] / rhs,
+            lhs.e[2] / rhs,
+            lhs.e[3] / rhs);
+    }
+
     // 2D
     template<vec2_type vec2>
     const vec2 operator+(vec2 lhs, vec2 rhs)
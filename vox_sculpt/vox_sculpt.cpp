@@ -14,6 +14,7 @@ import geometry;
 import platform;
 import vox_ints;
 import updater;
+import bench;
 
 #define MAX_LOADSTRING 100
 
@@ -47,6 +48,13 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
                      // so we avoid trying to launch work before threads are ready
     geometry::init(camera::inverse_lens_sample);
 
+    // Optional traversal benchmarks; these replay recorded ray sets against the volume we just loaded, then break
+//#define TRAVERSAL_BENCH
+#ifdef TRAVERSAL_BENCH
+    bench::traversal();
+    platform::osDebugBreak();
+#endif
+
     // Create the application window
     if (!ui::window_setup((void*)hInstance, nCmdShow, (void*)WndProc, szWindowClass, szTitle)) return FALSE;
 